@@ -0,0 +1,119 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   bench.c for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+/* Times prerendering a set of appearances with more and more threads, and
+   checks that every thread count gives the same pixels */
+
+#include <stdio.h>
+#include <X11/Xlib.h>
+#include "render.h"
+#include "prerender.h"
+#include <glib.h>
+
+#define APPEARANCES 64
+#define ROUNDS 5
+
+static guint32 checksum(RrAppearance **looks, gint *w, gint *h)
+{
+    guint32 sum = 2166136261u;
+    gint i, j;
+
+    for (i = 0; i < APPEARANCES; ++i) {
+        if (!RrPrerenderTake(looks[i], w[i], h[i]))
+            return 0;
+        for (j = 0; j < w[i] * h[i]; ++j)
+            sum = (sum ^ looks[i]->surface.pixel_data[j]) * 16777619u;
+    }
+    return sum;
+}
+
+gint main()
+{
+    Display *display;
+    RrInstance *inst;
+    RrAppearance *looks[APPEARANCES];
+    gint w[APPEARANCES], h[APPEARANCES];
+    gint i, threads, ncpu, round;
+    gint64 base = 0;
+    guint32 first = 0;
+
+    display = XOpenDisplay(NULL);
+    if (display == NULL) {
+        fprintf(stderr, "couldn't connect to the X server\n");
+        return 1;
+    }
+    inst = RrInstanceNew(display, DefaultScreen(display));
+
+    /* the surfaces which are always rendered on the CPU, at the size of a
+       large titlebar or menu */
+    for (i = 0; i < APPEARANCES; ++i) {
+        looks[i] = RrAppearanceNew(inst, 0);
+        looks[i]->surface.grad = (i % 2 ? RR_SURFACE_PYRAMID :
+                                  RR_SURFACE_SPLIT_VERTICAL);
+        looks[i]->surface.relief = RR_RELIEF_RAISED;
+        looks[i]->surface.bevel = RR_BEVEL_2;
+        looks[i]->surface.primary = RrColorParse(inst, "Blue");
+        looks[i]->surface.secondary = RrColorParse(inst, "Yellow");
+        looks[i]->surface.split_primary = RrColorParse(inst, "Green");
+        looks[i]->surface.split_secondary = RrColorParse(inst, "Red");
+        looks[i]->surface.bevel_light_adjust = 128;
+        looks[i]->surface.bevel_dark_adjust = 64;
+        w[i] = 800 + i * 7;
+        h[i] = 200 + (i * 13) % 400;
+        looks[i]->surface.pixel_data = g_new(RrPixel32, w[i] * h[i]);
+    }
+
+    ncpu = g_get_num_processors();
+    for (threads = 1; threads <= ncpu;
+         threads = (threads * 2 > ncpu && threads < ncpu) ? ncpu : threads * 2)
+    {
+        gint64 best = G_MAXINT64;
+        guint32 sum = 0;
+
+        RrPrerenderSetThreads(threads);
+        for (round = 0; round < ROUNDS; ++round) {
+            RrPrerender *p = RrPrerenderNew();
+            gint64 start;
+
+            for (i = 0; i < APPEARANCES; ++i)
+                RrPrerenderAdd(p, looks[i], w[i], h[i]);
+            start = g_get_monotonic_time();
+            RrPrerenderRun(p);
+            best = MIN(best, g_get_monotonic_time() - start);
+            sum = checksum(looks, w, h);
+            RrPrerenderFree(p);
+        }
+
+        if (threads == 1) {
+            base = best;
+            first = sum;
+        }
+        printf("%3d threads: %8.2f ms  %5.2fx  pixels %08x\n", threads,
+               best / 1000.0, (gdouble)base / best, sum);
+        if (sum != first) {
+            fprintf(stderr, "the pixels changed with %d threads\n", threads);
+            return 1;
+        }
+    }
+
+    for (i = 0; i < APPEARANCES; ++i)
+        RrAppearanceFree(looks[i]);
+    RrInstanceFree(inst);
+    XCloseDisplay(display);
+    return 0;
+}
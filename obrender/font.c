@@ -31,6 +31,130 @@
 #include <stdlib.h>
 #include <locale.h>
 
+/*! The number of measured strings to remember for each font */
+#define FONT_EXTENTS_CACHE_SIZE 256
+/*! The number of drawn strings to keep layouts for in each font */
+#define FONT_LAYOUT_CACHE_SIZE 64
+
+typedef struct _RrFontCacheKey   RrFontCacheKey;
+typedef struct _RrFontCacheEntry RrFontCacheEntry;
+
+/*! Identifies how a string was laid out */
+struct _RrFontCacheKey {
+    gchar *string;
+    gint width; /*!< The width in pixels, or -1 for no width */
+    gboolean flow;
+    PangoEllipsizeMode ellipsize;
+    gint shortcut; /*!< The byte position of the underlined char, or -1 */
+};
+
+struct _RrFontCacheEntry {
+    RrFontCacheKey key;
+    GList *link; /*!< The entry's place in the cache's lru list */
+    PangoRectangle rect; /*!< The logical extents of the string */
+    PangoLayout *layout; /*!< The laid out string, or NULL if not kept */
+};
+
+/*! A least-recently-used cache of strings laid out with one font */
+struct _RrFontCache {
+    GHashTable *table; /*!< Maps a RrFontCacheKey to its RrFontCacheEntry */
+    GQueue lru;        /*!< The entries, most recently used first */
+    guint max;
+    guint lookups;
+    guint hits;
+};
+
+static guint font_cache_key_hash(gconstpointer p)
+{
+    const RrFontCacheKey *k = p;
+    guint h;
+
+    h = g_str_hash(k->string);
+    h = h * 31 + (guint)k->width;
+    h = h * 31 + (guint)k->flow;
+    h = h * 31 + (guint)k->ellipsize;
+    h = h * 31 + (guint)k->shortcut;
+    return h;
+}
+
+static gboolean font_cache_key_equal(gconstpointer p1, gconstpointer p2)
+{
+    const RrFontCacheKey *a = p1, *b = p2;
+
+    return a->width == b->width && a->flow == b->flow &&
+        a->ellipsize == b->ellipsize && a->shortcut == b->shortcut &&
+        !strcmp(a->string, b->string);
+}
+
+static void font_cache_entry_free(gpointer data)
+{
+    RrFontCacheEntry *e = data;
+
+    if (e->layout) g_object_unref(e->layout);
+    g_free(e->key.string);
+    g_slice_free(RrFontCacheEntry, e);
+}
+
+static RrFontCache* font_cache_new(guint max)
+{
+    RrFontCache *c;
+
+    c = g_slice_new0(RrFontCache);
+    /* the entries own their keys */
+    c->table = g_hash_table_new_full(font_cache_key_hash,
+                                     font_cache_key_equal,
+                                     NULL, font_cache_entry_free);
+    g_queue_init(&c->lru);
+    c->max = max;
+    return c;
+}
+
+static void font_cache_free(RrFontCache *c)
+{
+    g_queue_clear(&c->lru);
+    g_hash_table_destroy(c->table);
+    g_slice_free(RrFontCache, c);
+}
+
+/*! Finds an entry in the cache, and marks it as the most recently used */
+static RrFontCacheEntry* font_cache_lookup(RrFontCache *c,
+                                           const RrFontCacheKey *k)
+{
+    RrFontCacheEntry *e;
+
+    ++c->lookups;
+    if ((e = g_hash_table_lookup(c->table, k))) {
+        ++c->hits;
+        g_queue_unlink(&c->lru, e->link);
+        g_queue_push_head_link(&c->lru, e->link);
+    }
+    return e;
+}
+
+/*! Adds a new entry to the cache, which takes a copy of the key's string.
+  The least recently used entry is dropped if the cache is full. */
+static RrFontCacheEntry* font_cache_add(RrFontCache *c,
+                                        const RrFontCacheKey *k)
+{
+    RrFontCacheEntry *e;
+
+    if (c->lru.length >= c->max) {
+        GList *last = g_queue_peek_tail_link(&c->lru);
+        RrFontCacheEntry *old = last->data;
+
+        g_queue_delete_link(&c->lru, last);
+        g_hash_table_remove(c->table, &old->key);
+    }
+
+    e = g_slice_new0(RrFontCacheEntry);
+    e->key = *k;
+    e->key.string = g_strdup(k->string);
+    g_queue_push_head(&c->lru, e);
+    e->link = c->lru.head;
+    g_hash_table_insert(c->table, &e->key, e);
+    return e;
+}
+
 static void measure_font(const RrInstance *inst, RrFont *f)
 {
     PangoFontMetrics *metrics;
@@ -66,23 +190,14 @@ RrFont *RrFontOpen(const RrInstance *inst, const gchar *name, gint size,
     RrFont *out;
     PangoWeight pweight;
     PangoStyle pstyle;
-    PangoAttrList *attrlist;
 
     out = g_slice_new(RrFont);
     out->inst = inst;
     out->ref = 1;
     out->font_desc = pango_font_description_new();
     out->layout = pango_layout_new(inst->pango);
-    out->shortcut_underline = pango_attr_underline_new(PANGO_UNDERLINE_SINGLE);
-    out->shortcut_underline->start_index = 0;
-    out->shortcut_underline->end_index = 0;
-
-    attrlist = pango_attr_list_new();
-    /* shortcut_underline is owned by the attrlist */
-    pango_attr_list_insert(attrlist, out->shortcut_underline);
-    /* the attributes are owned by the layout */
-    pango_layout_set_attributes(out->layout, attrlist);
-    pango_attr_list_unref(attrlist);
+    out->extents = font_cache_new(FONT_EXTENTS_CACHE_SIZE);
+    out->layouts = font_cache_new(FONT_LAYOUT_CACHE_SIZE);
 
     switch (weight) {
     case RR_FONTWEIGHT_LIGHT:     pweight = PANGO_WEIGHT_LIGHT;     break;
@@ -131,6 +246,8 @@ void RrFontClose(RrFont *f)
 {
     if (f) {
         if (--f->ref < 1) {
+            font_cache_free(f->layouts);
+            font_cache_free(f->extents);
             g_object_unref(f->layout);
             pango_font_description_free(f->font_desc);
             g_slice_free(RrFont, f);
@@ -143,6 +260,22 @@ static void font_measure_full(const RrFont *f, const gchar *str,
                               gboolean flow, gint maxwidth)
 {
     PangoRectangle rect;
+    RrFontCacheKey key;
+    RrFontCacheEntry *e;
+
+    /* the shadow is just added onto the size of the text, so it isn't part
+       of the key */
+    key.string = (gchar*)str;
+    key.width = flow ? maxwidth : -1;
+    key.flow = flow;
+    key.ellipsize = flow ? PANGO_ELLIPSIZE_NONE : PANGO_ELLIPSIZE_MIDDLE;
+    key.shortcut = -1;
+
+    if ((e = font_cache_lookup(f->extents, &key))) {
+        *x = e->rect.width + ABS(shadow_x) + 4;
+        *y = e->rect.height + ABS(shadow_y);
+        return;
+    }
 
     pango_layout_set_text(f->layout, str, -1);
     if (flow) {
@@ -169,6 +302,9 @@ static void font_measure_full(const RrFont *f, const gchar *str,
     rect.width = (rect.width + PANGO_SCALE - 1) / PANGO_SCALE;
     rect.height = (rect.height + PANGO_SCALE - 1) / PANGO_SCALE;
 #endif
+    e = font_cache_add(f->extents, &key);
+    e->rect = rect;
+
     *x = rect.width + ABS(shadow_x) + 4 /* we put a 2 px edge on each side */;
     *y = rect.height + ABS(shadow_y);
 }
@@ -187,6 +323,14 @@ RrSize *RrFontMeasureString(const RrFont *f, const gchar *str,
     return size;
 }
 
+void RrFontGetCacheStats(const RrFont *f, RrFontCacheStats *stats)
+{
+    stats->extents_lookups = f->extents->lookups;
+    stats->extents_hits = f->extents->hits;
+    stats->layout_lookups = f->layouts->lookups;
+    stats->layout_hits = f->layouts->hits;
+}
+
 gint RrFontHeight(const RrFont *f, gint shadow_y)
 {
     return (f->ascent + f->descent) / PANGO_SCALE + ABS(shadow_y);
@@ -215,13 +359,61 @@ static inline int font_calculate_baseline(RrFont *f, gint height)
         / PANGO_SCALE; /* back to pixels */
 }
 
+/*! Returns a layout of the text, ready to be drawn, and its width in pixels.
+  The layout is owned by the font's cache. */
+static PangoLayout* font_get_layout(RrFont *f, const RrTextureText *t,
+                                    gint w, PangoEllipsizeMode ell, gint *mw)
+{
+    RrFontCacheKey key;
+    RrFontCacheEntry *e;
+
+    key.string = (gchar*)t->string;
+    key.width = w;
+    key.flow = t->flow;
+    key.ellipsize = ell;
+    key.shortcut = t->shortcut ? (gint)t->shortcut_pos : -1;
+
+    if (!(e = font_cache_lookup(f->layouts, &key))) {
+        e = font_cache_add(f->layouts, &key);
+        e->layout = pango_layout_new(f->inst->pango);
+        pango_layout_set_font_description(e->layout, f->font_desc);
+        pango_layout_set_wrap(e->layout, PANGO_WRAP_WORD_CHAR);
+        pango_layout_set_text(e->layout, t->string, -1);
+        pango_layout_set_width(e->layout, w * PANGO_SCALE);
+        pango_layout_set_ellipsize(e->layout, ell);
+        pango_layout_set_single_paragraph_mode(e->layout, !t->flow);
+
+        if (t->shortcut) {
+            const gchar *s = t->string + t->shortcut_pos;
+            PangoAttribute *underline;
+            PangoAttrList *attrlist;
+
+            underline = pango_attr_underline_new(PANGO_UNDERLINE_SINGLE);
+            underline->start_index = t->shortcut_pos;
+            underline->end_index = t->shortcut_pos +
+                (g_utf8_next_char(s) - s);
+
+            attrlist = pango_attr_list_new();
+            /* the underline is owned by the attrlist */
+            pango_attr_list_insert(attrlist, underline);
+            /* the attributes are owned by the layout */
+            pango_layout_set_attributes(e->layout, attrlist);
+            pango_attr_list_unref(attrlist);
+        }
+
+        pango_layout_get_pixel_extents(e->layout, NULL, &e->rect);
+    }
+
+    *mw = e->rect.width;
+    return e->layout;
+}
+
 void RrFontDraw(XftDraw *d, RrTextureText *t, RrRect *area)
 {
     gint x,y,w;
     XftColor c;
     gint mw;
-    PangoRectangle rect;
-    PangoAttrList *attrlist;
+    PangoLayout *layout;
     PangoEllipsizeMode ell;
 
     g_assert(!t->flow || t->maxwidth > 0);
@@ -263,15 +455,7 @@ void RrFontDraw(XftDraw *d, RrTextureText *t, RrRect *area)
         }
     }
 
-    pango_layout_set_text(t->font->layout, t->string, -1);
-    pango_layout_set_width(t->font->layout, w * PANGO_SCALE);
-    pango_layout_set_ellipsize(t->font->layout, ell);
-    pango_layout_set_single_paragraph_mode(t->font->layout, !t->flow);
-
-    /* * * end of setting up the layout * * */
-
-    pango_layout_get_pixel_extents(t->font->layout, NULL, &rect);
-    mw = rect.width;
+    layout = font_get_layout(t->font, t, w, ell, &mw);
 
     /* pango_layout_set_alignment doesn't work with
        pango_xft_render_layout_line */
@@ -312,15 +496,15 @@ void RrFontDraw(XftDraw *d, RrTextureText *t, RrRect *area)
                 (d, &c,
 #if PANGO_VERSION_MAJOR > 1 || \
     (PANGO_VERSION_MAJOR == 1 && PANGO_VERSION_MINOR >= 16)
-                 pango_layout_get_line_readonly(t->font->layout, 0),
+                 pango_layout_get_line_readonly(layout, 0),
 #else
-                 pango_layout_get_line(t->font->layout, 0),
+                 pango_layout_get_line(layout, 0),
 #endif
                  (x + t->shadow_offset_x) * PANGO_SCALE,
                  (y + t->shadow_offset_y) * PANGO_SCALE);
         }
         else {
-            pango_xft_render_layout(d, &c, t->font->layout,
+            pango_xft_render_layout(d, &c, layout,
                                     (x + t->shadow_offset_x) * PANGO_SCALE,
                                     (y + t->shadow_offset_y) * PANGO_SCALE);
         }
@@ -332,22 +516,6 @@ void RrFontDraw(XftDraw *d, RrTextureText *t, RrRect *area)
     c.color.alpha = 0xff | 0xff << 8; /* fully opaque text */
     c.pixel = t->color->pixel;
 
-    if (t->shortcut) {
-        const gchar *s = t->string + t->shortcut_pos;
-
-        t->font->shortcut_underline->start_index = t->shortcut_pos;
-        t->font->shortcut_underline->end_index = t->shortcut_pos +
-            (g_utf8_next_char(s) - s);
-
-        /* the attributes are owned by the layout.
-           re-add the attributes to the layout after changing the
-           start and end index */
-        attrlist = pango_layout_get_attributes(t->font->layout);
-        pango_attr_list_ref(attrlist);
-        pango_layout_set_attributes(t->font->layout, attrlist);
-        pango_attr_list_unref(attrlist);
-    }
-
     /* layout_line() uses y to specify the baseline
        The line doesn't need to be freed, it's a part of the layout */
     if (!t->flow) {
@@ -355,28 +523,16 @@ void RrFontDraw(XftDraw *d, RrTextureText *t, RrRect *area)
             (d, &c,
 #if PANGO_VERSION_MAJOR > 1 || \
     (PANGO_VERSION_MAJOR == 1 && PANGO_VERSION_MINOR >= 16)
-             pango_layout_get_line_readonly(t->font->layout, 0),
+             pango_layout_get_line_readonly(layout, 0),
 #else
-             pango_layout_get_line(t->font->layout, 0),
+             pango_layout_get_line(layout, 0),
 #endif
              x * PANGO_SCALE,
              y * PANGO_SCALE);
     }
     else {
-        pango_xft_render_layout(d, &c, t->font->layout,
+        pango_xft_render_layout(d, &c, layout,
                                 x * PANGO_SCALE,
                                 y * PANGO_SCALE);
     }
-
-    if (t->shortcut) {
-        t->font->shortcut_underline->start_index = 0;
-        t->font->shortcut_underline->end_index = 0;
-        /* the attributes are owned by the layout.
-           re-add the attributes to the layout after changing the
-           start and end index */
-        attrlist = pango_layout_get_attributes(t->font->layout);
-        pango_attr_list_ref(attrlist);
-        pango_layout_set_attributes(t->font->layout, attrlist);
-        pango_attr_list_unref(attrlist);
-    }
 }
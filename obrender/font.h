@@ -23,14 +23,17 @@
 #include "geom.h"
 #include <pango/pango.h>
 
+typedef struct _RrFontCache RrFontCache;
+
 struct _RrFont {
     const RrInstance *inst;
     gint ref;
     PangoFontDescription *font_desc;
-    PangoLayout *layout; /*!< Used for measuring and rendering strings */
-    PangoAttribute *shortcut_underline; /*< For underlining the shortcut key */
+    PangoLayout *layout; /*!< Used for measuring strings */
     gint ascent; /*!< The font's ascent in pango-units */
     gint descent; /*!< The font's descent in pango-units */
+    RrFontCache *extents; /*!< Recently measured strings */
+    RrFontCache *layouts; /*!< Recently drawn strings, ready to render */
 };
 
 void RrFontDraw(XftDraw *d, RrTextureText *t, RrRect *position);
@@ -21,13 +21,17 @@
 #include "render.h"
 #include "gradient.h"
 #include "color.h"
+#include "instance.h"
 #include <glib.h>
 #include <string.h>
 
+static void render(RrAppearance *a, gint w, gint h, gboolean draw);
 static void highlight(RrSurface *s, RrPixel32 *x, RrPixel32 *y,
                       gboolean raised);
-static void gradient_parentrelative(RrAppearance *a, gint w, gint h);
-static void gradient_solid(RrAppearance *l, gint w, gint h);
+static void gradient_parentrelative(RrAppearance *a, gint w, gint h,
+                                    gboolean draw);
+static void gradient_solid(RrAppearance *l, gint w, gint h, gboolean draw);
+static void solid_draw(RrAppearance *l, gint w, gint h);
 static void gradient_splitvertical(RrAppearance *a, gint w, gint h);
 static void gradient_vertical(RrSurface *sf, gint w, gint h);
 static void gradient_horizontal(RrSurface *sf, gint w, gint h);
@@ -37,6 +41,24 @@ static void gradient_crossdiagonal(RrSurface *sf, gint w, gint h);
 static void gradient_pyramid(RrSurface *sf, gint inw, gint inh);
 
 void RrRender(RrAppearance *a, gint w, gint h)
+{
+    render(a, w, h, TRUE);
+}
+
+void RrRenderPixels(const RrAppearance *a, gint w, gint h, RrPixel32 *data)
+{
+    RrAppearance copy = *a;
+
+    g_assert(a->surface.grad != RR_SURFACE_PARENTREL);
+
+    /* without drawing, rendering only writes to the pixel data */
+    copy.surface.pixel_data = data;
+    render(&copy, w, h, FALSE);
+}
+
+/*! Render the appearance's surface into its pixel_data.  Solid surfaces are
+  also drawn straight into the pixmap if draw is TRUE */
+static void render(RrAppearance *a, gint w, gint h, gboolean draw)
 {
     RrPixel32 *data = a->surface.pixel_data;
     RrPixel32 current;
@@ -45,10 +67,10 @@ void RrRender(RrAppearance *a, gint w, gint h)
 
     switch (a->surface.grad) {
     case RR_SURFACE_PARENTREL:
-        gradient_parentrelative(a, w, h);
+        gradient_parentrelative(a, w, h, draw);
         break;
     case RR_SURFACE_SOLID:
-        gradient_solid(a, w, h);
+        gradient_solid(a, w, h, draw);
         break;
     case RR_SURFACE_SPLIT_VERTICAL:
         gradient_splitvertical(a, w, h);
@@ -265,7 +287,8 @@ static inline void repeat_pixel(RrPixel32 *start, gint w)
     }
 }
 
-static void gradient_parentrelative(RrAppearance *a, gint w, gint h)
+static void gradient_parentrelative(RrAppearance *a, gint w, gint h,
+                                    gboolean draw)
 {
     RrPixel32 *source, *dest;
     gint sw, sh, partial_w, partial_h;
@@ -296,9 +319,16 @@ static void gradient_parentrelative(RrAppearance *a, gint w, gint h)
 
         a->surface.pixel_data = old.pixel_data;
 
-        RrRender(a, w, h);
+        render(a, w, h, draw);
         a->surface = old;
     } else {
+        if (a->surface.parent->surface.pixel_data_stale) {
+            /* the parent was drawn by the X server, so find its pixels now,
+               without drawing over the parent's pixmap */
+            render(a->surface.parent, sw, sh, FALSE);
+            a->surface.parent->surface.pixel_data_stale = FALSE;
+        }
+
         source = (a->surface.parent->surface.pixel_data +
                   a->surface.parentx + sw * a->surface.parenty);
         dest = a->surface.pixel_data;
@@ -317,13 +347,12 @@ static void gradient_parentrelative(RrAppearance *a, gint w, gint h)
     }
 }
 
-static void gradient_solid(RrAppearance *l, gint w, gint h)
+static void gradient_solid(RrAppearance *l, gint w, gint h, gboolean draw)
 {
     register gint i;
     RrPixel32 pix;
     RrPixel32 *data = l->surface.pixel_data;
     RrSurface *sp = &l->surface;
-    gint left = 0, top = 0, right = w - 1, bottom = h - 1;
 
     pix = (sp->primary->r << RrDefaultRedOffset)
         + (sp->primary->g << RrDefaultGreenOffset)
@@ -332,9 +361,18 @@ static void gradient_solid(RrAppearance *l, gint w, gint h)
     for (i = 0; i < w * h; i++)
         *data++ = pix;
 
-    if (sp->interlaced)
+    if (sp->interlaced || !draw)
         return;
 
+    solid_draw(l, w, h);
+}
+
+/*! Draw a solid surface which isn't interlaced, with its bevel or border */
+static void solid_draw(RrAppearance *l, gint w, gint h)
+{
+    RrSurface *sp = &l->surface;
+    gint left = 0, top = 0, right = w - 1, bottom = h - 1;
+
     XFillRectangle(RrDisplay(l->inst), l->pixmap, RrColorGC(sp->primary),
                    0, 0, w, h);
 
@@ -836,3 +874,255 @@ static void gradient_pyramid(RrSurface *sf, gint w, gint h)
         cp += w;
     }
 }
+
+/* * * * * * * * * * * * * * * DRAWN BY THE SERVER * * * * * * * * * * * * * */
+
+static void interlace_draw(RrAppearance *a, gint w, gint h)
+{
+    XRectangle *rows;
+    gint i, n;
+
+    n = (h + 1) / 2;
+    rows = g_new(XRectangle, n);
+    for (i = 0; i < n; ++i) {
+        rows[i].x = 0;
+        rows[i].y = i * 2;
+        rows[i].width = w;
+        rows[i].height = 1;
+    }
+    XFillRectangles(RrDisplay(a->inst), a->pixmap,
+                    RrColorGC(a->surface.interlace_color), rows, n);
+    g_free(rows);
+}
+
+#ifdef USE_XRENDER
+/*! Lighten a color channel when adjust is positive, or darken it when adjust
+  is negative, the same way that highlight() does */
+static gushort adjust_channel(gint c, gint adjust)
+{
+    if (adjust > 0)
+        c += (c * adjust) >> 8;
+    else
+        c -= (c * -adjust) >> 8;
+    if (c > 0xFF) c = 0xFF;
+    return c * 0x101;
+}
+
+static void render_color(const RrColor *c, gint adjust, XRenderColor *out)
+{
+    out->red = adjust_channel(c->r, adjust);
+    out->green = adjust_channel(c->g, adjust);
+    out->blue = adjust_channel(c->b, adjust);
+    out->alpha = 0xFFFF;
+}
+
+/*! Make a picture of the surface's gradient with its colors adjusted as in
+  adjust_channel().  Returns None if the X server can't draw the gradient */
+static Picture gradient_picture(RrAppearance *a, gint w, gint h, gint adjust)
+{
+    RrSurface *sf = &a->surface;
+    XLinearGradient line;
+    XFixed stops[3];
+    XRenderColor colors[3];
+    XRenderPictureAttributes attr;
+    Picture p;
+    gint n = 2;
+    /* the gradients go from the middle of the first pixel to the middle of
+       the last one, the same as the ones from RrRender */
+    const gdouble fw = w - 1, fh = h - 1;
+    gdouble dx, dy;
+
+    render_color(sf->primary, adjust, &colors[0]);
+    render_color(sf->secondary, adjust, &colors[1]);
+    stops[0] = XDoubleToFixed(0);
+    stops[1] = XDoubleToFixed(1);
+
+    switch (sf->grad) {
+    case RR_SURFACE_MIRROR_HORIZONTAL:
+        /* out to the secondary color in the middle and back again */
+        colors[2] = colors[0];
+        stops[1] = XDoubleToFixed(0.5);
+        stops[2] = XDoubleToFixed(1);
+        n = 3;
+        /* fall through */
+    case RR_SURFACE_HORIZONTAL:
+        line.p1.x = XDoubleToFixed(0.5);
+        line.p2.x = XDoubleToFixed(fw + 0.5);
+        line.p1.y = line.p2.y = 0;
+        break;
+    case RR_SURFACE_VERTICAL:
+        line.p1.x = line.p2.x = 0;
+        line.p1.y = XDoubleToFixed(0.5);
+        line.p2.y = XDoubleToFixed(fh + 0.5);
+        break;
+    case RR_SURFACE_DIAGONAL:
+    case RR_SURFACE_CROSS_DIAGONAL:
+        /* blending down both sides and then across each row works out to a
+           straight gradient from one corner to the opposite one, along which
+           the color stays the same across each line parallel to the other
+           diagonal */
+        dx = 2 * fw * fh * fh / (fw * fw + fh * fh);
+        dy = 2 * fw * fw * fh / (fw * fw + fh * fh);
+        if (sf->grad == RR_SURFACE_DIAGONAL) {
+            line.p1.x = XDoubleToFixed(0.5);
+            line.p2.x = XDoubleToFixed(0.5 + dx);
+        } else {
+            line.p1.x = XDoubleToFixed(fw + 0.5);
+            line.p2.x = XDoubleToFixed(fw + 0.5 - dx);
+        }
+        line.p1.y = XDoubleToFixed(0.5);
+        line.p2.y = XDoubleToFixed(0.5 + dy);
+        break;
+    default:
+        return None;
+    }
+
+    p = XRenderCreateLinearGradient(RrDisplay(a->inst), &line,
+                                    stops, colors, n);
+    /* rounding can leave the corners just outside of the gradient */
+    attr.repeat = RepeatPad;
+    XRenderChangePicture(RrDisplay(a->inst), p, CPRepeat, &attr);
+    return p;
+}
+
+static void edge_draw(RrAppearance *a, Picture src, Picture dest,
+                      const gint *e)
+{
+    /* e is the x, y, width and height of the edge */
+    if (e[2] > 0 && e[3] > 0)
+        XRenderComposite(RrDisplay(a->inst), PictOpSrc, src, None, dest,
+                         e[0], e[1], 0, 0, e[0], e[1], e[2], e[3]);
+}
+
+/*! Draw the bevel over a gradient by drawing its edges again with the
+  gradient lightened or darkened */
+static void bevel_draw(RrAppearance *a, Picture dest, gint w, gint h)
+{
+    RrSurface *sf = &a->surface;
+    Picture light, dark;
+    /* the top, left, bottom and right edges */
+    gint e[4][4];
+
+    switch (sf->bevel) {
+    case RR_BEVEL_1:
+        e[0][0] = 1;     e[0][1] = 0;     e[0][2] = w - 2; e[0][3] = 1;
+        e[1][0] = 0;     e[1][1] = 0;     e[1][2] = 1;     e[1][3] = h;
+        e[2][0] = 1;     e[2][1] = h - 1; e[2][2] = w - 2; e[2][3] = 1;
+        e[3][0] = w - 1; e[3][1] = 0;     e[3][2] = 1;     e[3][3] = h;
+        break;
+    case RR_BEVEL_2:
+        e[0][0] = 2;     e[0][1] = 1;     e[0][2] = w - 4; e[0][3] = 1;
+        e[1][0] = 1;     e[1][1] = 1;     e[1][2] = 1;     e[1][3] = h - 2;
+        e[2][0] = 2;     e[2][1] = h - 2; e[2][2] = w - 4; e[2][3] = 1;
+        e[3][0] = w - 2; e[3][1] = 1;     e[3][2] = 1;     e[3][3] = h - 2;
+        break;
+    default:
+        g_assert_not_reached(); /* unhandled BevelType */
+    }
+
+    light = gradient_picture(a, w, h, sf->bevel_light_adjust);
+    dark = gradient_picture(a, w, h, -sf->bevel_dark_adjust);
+    if (sf->relief == RR_RELIEF_RAISED) {
+        edge_draw(a, light, dest, e[0]);
+        edge_draw(a, light, dest, e[1]);
+        edge_draw(a, dark, dest, e[2]);
+        edge_draw(a, dark, dest, e[3]);
+    } else {
+        edge_draw(a, dark, dest, e[0]);
+        edge_draw(a, dark, dest, e[1]);
+        edge_draw(a, light, dest, e[2]);
+        edge_draw(a, light, dest, e[3]);
+    }
+    XRenderFreePicture(RrDisplay(a->inst), light);
+    XRenderFreePicture(RrDisplay(a->inst), dark);
+}
+
+static void gradient_draw(RrAppearance *a, gint w, gint h)
+{
+    Picture src, dest;
+
+    src = gradient_picture(a, w, h, 0);
+    g_assert(src != None);
+
+    dest = XRenderCreatePicture(RrDisplay(a->inst), a->pixmap,
+                                RrRenderFormat(a->inst), 0, NULL);
+    XRenderComposite(RrDisplay(a->inst), PictOpSrc, src, None, dest,
+                     0, 0, 0, 0, 0, 0, w, h);
+    XRenderFreePicture(RrDisplay(a->inst), src);
+
+    if (a->surface.relief != RR_RELIEF_FLAT)
+        bevel_draw(a, dest, w, h);
+    XRenderFreePicture(RrDisplay(a->inst), dest);
+}
+#endif
+
+gboolean RrRenderServerSupported(const RrAppearance *a, gint w, gint h)
+{
+    const RrSurface *sf = &a->surface;
+    gint i;
+
+    /* images are drawn into the pixel data, on top of the surface */
+    for (i = 0; i < a->textures; i++)
+        if (a->texture[i].type == RR_TEXTURE_IMAGE ||
+            a->texture[i].type == RR_TEXTURE_RGBA)
+            return FALSE;
+
+    /* the bevel changes the color of the pixels under it, which aren't all
+       the same color along an edge once it is interlaced */
+    if (sf->interlaced && sf->relief != RR_RELIEF_FLAT)
+        return FALSE;
+
+    switch (sf->grad) {
+    case RR_SURFACE_SOLID:
+        return TRUE;
+    case RR_SURFACE_HORIZONTAL:
+    case RR_SURFACE_MIRROR_HORIZONTAL:
+    case RR_SURFACE_VERTICAL:
+    case RR_SURFACE_DIAGONAL:
+    case RR_SURFACE_CROSS_DIAGONAL:
+#ifdef USE_XRENDER
+        /* a gradient needs two pixels to go between */
+        return RrRenderFormat(a->inst) && w > 1 && h > 1;
+#else
+        return FALSE;
+#endif
+    default:
+        /* parent relative surfaces are made from their parent's pixels, and
+           the other gradients are left to RrRender */
+        return FALSE;
+    }
+}
+
+void RrRenderServer(RrAppearance *a, gint w, gint h)
+{
+    RrSurface *sf = &a->surface;
+
+    switch (sf->grad) {
+    case RR_SURFACE_SOLID:
+        if (!sf->interlaced) {
+            solid_draw(a, w, h);
+            return;
+        }
+        XFillRectangle(RrDisplay(a->inst), a->pixmap,
+                       RrColorGC(sf->primary), 0, 0, w, h);
+        break;
+#ifdef USE_XRENDER
+    case RR_SURFACE_HORIZONTAL:
+    case RR_SURFACE_MIRROR_HORIZONTAL:
+    case RR_SURFACE_VERTICAL:
+    case RR_SURFACE_DIAGONAL:
+    case RR_SURFACE_CROSS_DIAGONAL:
+        gradient_draw(a, w, h);
+        break;
+#endif
+    default:
+        g_assert_not_reached(); /* see RrRenderServerSupported */
+    }
+
+    if (sf->interlaced)
+        interlace_draw(a, w, h);
+
+    if (sf->relief == RR_RELIEF_FLAT && sf->border)
+        XDrawRectangle(RrDisplay(a->inst), a->pixmap,
+                       RrColorGC(sf->border_color), 0, 0, w - 1, h - 1);
+}
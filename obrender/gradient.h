@@ -23,5 +23,15 @@
 #include "render.h"
 
 void RrRender(RrAppearance *a, gint w, gint h);
+/*! Render the appearance's surface into the given pixels without touching
+  the appearance, so it is safe to call from other threads.  The surface can
+  not be parent relative */
+void RrRenderPixels(const RrAppearance *a, gint w, gint h, RrPixel32 *data);
+/*! Returns TRUE if the appearance's surface can be drawn by the X server,
+  otherwise it has to be rendered with RrRender */
+gboolean RrRenderServerSupported(const RrAppearance *a, gint w, gint h);
+/*! Draw the appearance's surface straight into its pixmap with the X server,
+  leaving its pixel_data stale */
+void RrRenderServer(RrAppearance *a, gint w, gint h);
 
 #endif /* __gradient_h */
@@ -30,6 +30,11 @@
 #endif
 
 #include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+/*! The number of threads which decode named images */
+#define LOAD_THREADS 2
 
 #define FRACTION        12
 #define FLOOR(i)        ((i) & (~0UL << FRACTION))
@@ -60,6 +65,8 @@ static void RrImagePicInit(RrImagePic *pic, gint w, gint h, RrPixel32 *data)
     pic->width = w;
     pic->height = h;
     pic->data = data;
+    pic->lru = NULL;
+    pic->set = NULL;
     pic->sum = 0;
     for (i = w*h; i > 0; --i)
         pic->sum += *(data++);
@@ -129,12 +136,12 @@ static void RrImageSetFree(RrImageSet *self)
            be keys in the cache to RrImageSet objects, so remove them from
            the cache's pic_table as well. */
         for (i = 0; i < self->n_original; ++i) {
-            g_hash_table_remove(self->cache->pic_table, self->original[i]);
+            RrImageCacheRemovePicture(self->cache, self->original[i]);
             RrImagePicFree(self->original[i]);
         }
         g_free(self->original);
         for (i = 0; i < self->n_resized; ++i) {
-            g_hash_table_remove(self->cache->pic_table, self->resized[i]);
+            RrImageCacheRemovePicture(self->cache, self->resized[i]);
             RrImagePicFree(self->resized[i]);
         }
         g_free(self->resized);
@@ -169,7 +176,7 @@ static void RrImageSetRemovePictureAt(RrImageSet *self, gint i,
     g_assert(i >= 0 && i < *len);
 
     /* remove the picture data as a key in the cache */
-    g_hash_table_remove(self->cache->pic_table, (*list)[i]);
+    RrImageCacheRemovePicture(self->cache, (*list)[i]);
 
     /* free the picture being removed */
     RrImagePicFree((*list)[i]);
@@ -224,7 +231,7 @@ static void RrImageSetAddPicture(RrImageSet *self, RrImagePic *pic,
     (*list)[0] = pic;
 
     /* add the picture as a key to point to this image in the cache */
-    g_hash_table_insert(self->cache->pic_table, (*list)[0], self);
+    RrImageCacheAddPicture(self->cache, (*list)[0], self, !original);
 
 /*
 #ifdef DEBUG
@@ -295,14 +302,14 @@ RrImageSet* RrImageSetMergeSets(RrImageSet *b, RrImageSet *a)
     */
     tmp = a_i;
     for (; a_i < a->n_resized; ++a_i) {
-        g_hash_table_remove(a->cache->pic_table, a->resized[a_i]);
+        RrImageCacheRemovePicture(a->cache, a->resized[a_i]);
         RrImagePicFree(a->resized[a_i]);
     }
     a->n_resized = tmp;
 
     tmp = b_i;
     for (; b_i < b->n_resized; ++b_i) {
-        g_hash_table_remove(a->cache->pic_table, b->resized[b_i]);
+        RrImageCacheRemovePicture(a->cache, b->resized[b_i]);
         RrImagePicFree(b->resized[b_i]);
     }
     b->n_resized = tmp;
@@ -326,10 +333,14 @@ RrImageSet* RrImageSetMergeSets(RrImageSet *b, RrImageSet *a)
 
     for (it = b->names; it; it = g_slist_next(it))
         g_hash_table_insert(a->cache->name_table, it->data, a);
-    for (b_i = 0; b_i < b->n_original; ++b_i)
+    for (b_i = 0; b_i < b->n_original; ++b_i) {
         g_hash_table_insert(a->cache->pic_table, b->original[b_i], a);
-    for (b_i = 0; b_i < b->n_resized; ++b_i)
+        b->original[b_i]->set = a;
+    }
+    for (b_i = 0; b_i < b->n_resized; ++b_i) {
         g_hash_table_insert(a->cache->pic_table, b->resized[b_i], a);
+        b->resized[b_i]->set = a;
+    }
 
     for (it = b->images; it; it = g_slist_next(it))
         ((RrImage*)it->data)->set = a;
@@ -431,6 +442,19 @@ void RrImageAddFromData(RrImage *self, RrPixel32 *data, gint w, gint h)
     }
 }
 
+/*! Makes a new RrImage with a new, empty RrImageSet */
+static RrImage* RrImageNewEmpty(RrImageCache *cache)
+{
+    RrImage *self;
+
+    self = g_slice_new0(RrImage);
+    self->ref = 1;
+    self->set = g_slice_new0(RrImageSet);
+    self->set->cache = cache;
+    self->set->images = g_slist_append(self->set->images, self);
+    return self;
+}
+
 RrImage* RrImageNewFromData(RrImageCache *cache, RrPixel32 *data,
                             gint w, gint h)
 {
@@ -456,11 +480,7 @@ RrImage* RrImageNewFromData(RrImageCache *cache, RrPixel32 *data,
        a new RrImageSet, and a new RrImage that points to it, and place the
        new image inside the new RrImageSet */
 
-    self = g_slice_new0(RrImage);
-    self->ref = 1;
-    self->set = g_slice_new0(RrImageSet);
-    self->set->cache = cache;
-    self->set->images = g_slist_append(self->set->images, self);
+    self = RrImageNewEmpty(cache);
 
     ppic = RrImagePicNew(w, h, data);
     RrImageSetAddPicture(self->set, ppic, TRUE);
@@ -611,84 +631,340 @@ RsvgLoader* LoadWithRsvg(gchar *path,
 }
 #endif  /* USE_LIBRSVG */
 
-RrImage* RrImageNewFromName(RrImageCache *cache, const gchar *name)
+/************************************************************************
+ Loading named images.
+
+ Decoding image files, and rasterizing SVGs especially, is slow, so it is
+ done by a pool of threads.  An RrImage is given out right away with no
+ pictures in it, and the picture is added to it back in the main loop when
+ it has been decoded.  Until then, drawing the image draws nothing.
+**************************************************************************/
+
+typedef struct _RrImageLoad RrImageLoad;
+
+struct _RrImageLoad
 {
-    RrImage *self;
-    RrImageSet *set;
-    gint w, h;
-    RrPixel32 *data;
+    RrImage *image; /* holds a reference until the load is finished */
     gchar *path;
-    gboolean loaded;
+    /* the decoded picture, or NULL if it couldn't be loaded */
+    RrPixel32 *data;
+    gint width, height;
+};
+
+static GThreadPool *load_pool = NULL;
+/*! RrImageLoads which the threads have finished with */
+static GAsyncQueue *load_done = NULL;
 
 #if defined(USE_IMLIB2)
-    ImlibLoader *imlib_loader = NULL;
+/*! Imlib2 is not thread safe, so only one thread can use it at a time */
+static GMutex imlib_lock;
 #endif
+
 #if defined(USE_LIBRSVG)
-    RsvgLoader *rsvg_loader = NULL;
-#endif
+/*! Where rasterized SVGs are saved, so they can be loaded quickly the next
+  time, or NULL to not save them */
+static gchar *svg_cache_dir = NULL;
+/*! Old pictures are removed from svg_cache_dir once each time openbox runs */
+static gboolean svg_cache_pruned = FALSE;
+
+#define SVG_CACHE_MAGIC 0x4f427376 /* "OBsv" */
+/*! Saved pictures which haven't been written for this long are removed, in
+  seconds */
+#define SVG_CACHE_AGE (30 * 24 * 60 * 60)
+
+/*! The start of a saved picture.  It is followed by width*height RrPixel32s,
+  all in native byte order. */
+typedef struct _SvgCacheHeader {
+    guint32 magic;
+    guint32 width;
+    guint32 height;
+    guint32 unused;
+    /* the image file that the picture was made from */
+    gint64 mtime;
+    gint64 size;
+} SvgCacheHeader;
+
+/*! Returns the file in svg_cache_dir for an image file, and stats the image
+  file.  It is named for the image file's path only, so when the image file
+  changes its new picture replaces the old one. */
+static gchar* svg_cache_file(const gchar *path, GStatBuf *st)
+{
+    gchar *sum, *file;
 
-    g_return_val_if_fail(cache != NULL, NULL);
-    g_return_val_if_fail(name != NULL, NULL);
+    if (!svg_cache_dir || g_stat(path, st) < 0)
+        return NULL;
 
-    set = g_hash_table_lookup(cache->name_table, name);
-    if (set) {
-        self = set->images->data;
-        RrImageRef(self);
-        return self;
+    sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, path, -1);
+    file = g_strconcat(svg_cache_dir, G_DIR_SEPARATOR_S, sum, ".argb", NULL);
+    g_free(sum);
+    return file;
+}
+
+/*! Removes the saved pictures which have not been written in a while, such
+  as ones for image files which are gone */
+static void svg_cache_prune(void)
+{
+    GDir *dir;
+    const gchar *name;
+    gint64 now;
+
+    if (!(dir = g_dir_open(svg_cache_dir, 0, NULL)))
+        return;
+
+    now = g_get_real_time() / G_USEC_PER_SEC;
+    while ((name = g_dir_read_name(dir))) {
+        gchar *file;
+        GStatBuf st;
+
+        if (!g_str_has_suffix(name, ".argb")) continue;
+
+        file = g_build_filename(svg_cache_dir, name, NULL);
+        if (g_stat(file, &st) == 0 && now - st.st_mtime > SVG_CACHE_AGE)
+            g_unlink(file);
+        g_free(file);
     }
+    g_dir_close(dir);
+}
 
-    /* XXX find the path via freedesktop icon spec (use obt) ! */
-    path = g_strdup(name);
+/*! Reads a saved picture, if it was made from the image file as it is now */
+static gboolean svg_cache_read(const gchar *file, const GStatBuf *st,
+                               RrImageLoad *l)
+{
+    gchar *contents;
+    gsize len;
+    SvgCacheHeader h;
+
+    if (!g_file_get_contents(file, &contents, &len, NULL))
+        return FALSE;
+
+    if (len < sizeof(h)) goto bad;
+    memcpy(&h, contents, sizeof(h));
+    if (h.magic != SVG_CACHE_MAGIC ||
+        h.mtime != (gint64)st->st_mtime || h.size != (gint64)st->st_size ||
+        h.width == 0 || h.height == 0 ||
+        h.width > G_MAXUINT16 || h.height > G_MAXUINT16 ||
+        len - sizeof(h) != (gsize)h.width * h.height * sizeof(RrPixel32))
+        goto bad;
+
+    l->width = h.width;
+    l->height = h.height;
+    memmove(contents, contents + sizeof(h), len - sizeof(h));
+    l->data = (RrPixel32*)contents;
+    return TRUE;
+
+bad:
+    g_free(contents);
+    return FALSE;
+}
 
-    loaded = FALSE;
-#if defined(USE_LIBRSVG)
-    if (!loaded) {
-        rsvg_loader = LoadWithRsvg(path, &data, &w, &h);
-        loaded = !!rsvg_loader;
+static void svg_cache_write(const gchar *file, const GStatBuf *st,
+                            const RrImageLoad *l)
+{
+    gsize size;
+    gchar *buf;
+    SvgCacheHeader h;
+
+    size = (gsize)l->width * l->height * sizeof(RrPixel32);
+    h.magic = SVG_CACHE_MAGIC;
+    h.width = l->width;
+    h.height = l->height;
+    h.unused = 0;
+    h.mtime = st->st_mtime;
+    h.size = st->st_size;
+
+    buf = g_malloc(sizeof(h) + size);
+    memcpy(buf, &h, sizeof(h));
+    memcpy(buf + sizeof(h), l->data, size);
+    /* it's only a cache, so it doesn't matter if this fails.  this replaces
+       any picture saved from an older version of the image file */
+    g_file_set_contents(file, buf, sizeof(h) + size, NULL);
+    g_free(buf);
+}
+
+static void load_svg(RrImageLoad *l)
+{
+    RsvgLoader *loader;
+    RrPixel32 *data;
+    gchar *file;
+    GStatBuf st;
+
+    file = svg_cache_file(l->path, &st);
+    if (file && svg_cache_read(file, &st, l)) {
+        g_free(file);
+        return;
     }
-#endif
+
+    if ((loader = LoadWithRsvg(l->path, &data, &l->width, &l->height))) {
+        /* take the picture from the loader */
+        l->data = loader->pixel_data;
+        loader->pixel_data = NULL;
+        if (file)
+            svg_cache_write(file, &st, l);
+        DestroyRsvgLoader(loader);
+    }
+    g_free(file);
+}
+#endif  /* USE_LIBRSVG */
+
 #if defined(USE_IMLIB2)
-    if (!loaded) {
-        imlib_loader = LoadWithImlib(path, &data, &w, &h);
-        loaded = !!imlib_loader;
+static void load_imlib(RrImageLoad *l)
+{
+    ImlibLoader *loader;
+    RrPixel32 *data;
+
+    g_mutex_lock(&imlib_lock);
+    if ((loader = LoadWithImlib(l->path, &data, &l->width, &l->height))) {
+        /* the data belongs to imlib */
+        l->data = g_memdup(data, l->width * l->height * sizeof(RrPixel32));
+        DestroyImlibLoader(loader);
     }
-#endif
+    g_mutex_unlock(&imlib_lock);
+}
+#endif  /* USE_IMLIB2 */
+
+/*! Adds the pictures which have been decoded to their images.  This runs in
+  the main loop. */
+static gboolean load_finish(gpointer data)
+{
+    RrImageLoad *l;
+
+    if (!load_done) return FALSE; /* already finished by RrImageLoadWait */
+
+    while ((l = g_async_queue_try_pop(load_done))) {
+        RrImageCache *cache = l->image->set->cache;
+
+        if (!l->data) {
+            RrImageSet *set = l->image->set;
+            GSList *it;
+
+            g_message("Cannot load image from file \"%s\"", l->path);
+            /* so that asking for it again will try again */
+            for (it = set->names; it; it = g_slist_next(it)) {
+                g_hash_table_remove(cache->name_table, it->data);
+                g_free(it->data);
+            }
+            g_slist_free(set->names);
+            set->names = NULL;
+        }
+        /* if nothing else is holding the image, don't bother */
+        else if (l->image->ref > 1) {
+            RrImageAddFromData(l->image, l->data, l->width, l->height);
+            if (cache->loaded_func)
+                cache->loaded_func(l->image, cache->loaded_data);
+        }
+
+        RrImageUnref(l->image);
+        g_free(l->data);
+        g_free(l->path);
+        g_slice_free(RrImageLoad, l);
+    }
+    return FALSE; /* remove the idle source */
+}
+
+#if defined(USE_LIBRSVG) || defined(USE_IMLIB2)
+static void load_thread(gpointer data, gpointer user_data)
+{
+    RrImageLoad *l = data;
 
-    if (!loaded) {
-        g_message("Cannot load image \"%s\" from file \"%s\"", name, path);
-        g_free(path);
 #if defined(USE_LIBRSVG)
-        DestroyRsvgLoader(rsvg_loader);
+    if (!l->data)
+        load_svg(l);
 #endif
 #if defined(USE_IMLIB2)
-        DestroyImlibLoader(imlib_loader);
+    if (!l->data)
+        load_imlib(l);
 #endif
-        return NULL;
-    }
 
-    g_free(path);
+    g_async_queue_push(load_done, l);
+    g_idle_add(load_finish, NULL);
+}
 
-    /* get an RrImage that contains an RrImageSet with this picture in it.
-       the RrImage might be new, or reused if the picture was already in the
-       cache.
+static void load_start(RrImage *image, gchar *path)
+{
+    RrImageLoad *l;
 
-       either way, we get back an RrImageSet (via the RrImage), and we must add
-       the name to that RrImageSet.  because of the check above, we know that
-       there is no RrImageSet in the cache which already has the given name
-       asosciated with it.
-    */
+    if (!load_pool) {
+        load_done = g_async_queue_new();
+        load_pool = g_thread_pool_new(load_thread, NULL, LOAD_THREADS,
+                                      FALSE, NULL);
+#if defined(USE_LIBRSVG)
+        svg_cache_dir = g_build_filename(g_get_user_cache_dir(),
+                                         "openbox", "icons", NULL);
+        if (g_mkdir_with_parents(svg_cache_dir, 0700) < 0) {
+            g_free(svg_cache_dir);
+            svg_cache_dir = NULL;
+        }
+        else if (!svg_cache_pruned) {
+            svg_cache_prune();
+            svg_cache_pruned = TRUE;
+        }
+#endif
+    }
 
-    self = RrImageNewFromData(cache, data, w, h);
-    RrImageSetAddName(self->set, name);
+    l = g_slice_new0(RrImageLoad);
+    l->image = image;
+    RrImageRef(image);
+    l->path = path;
+    g_thread_pool_push(load_pool, l, NULL);
+}
+#endif
 
+void RrImageLoadWait(void)
+{
+    if (!load_pool) return;
+
+    /* let the threads finish what they have, and then use it */
+    g_thread_pool_free(load_pool, FALSE, TRUE);
+    load_pool = NULL;
+    load_finish(NULL);
+    g_async_queue_unref(load_done);
+    load_done = NULL;
 #if defined(USE_LIBRSVG)
-    DestroyRsvgLoader(rsvg_loader);
+    g_free(svg_cache_dir);
+    svg_cache_dir = NULL;
 #endif
-#if defined(USE_IMLIB2)
-    DestroyImlibLoader(imlib_loader);
+}
+
+RrImage* RrImageNewFromName(RrImageCache *cache, const gchar *name)
+{
+    RrImage *self;
+    RrImageSet *set;
+    gchar *path;
+
+    g_return_val_if_fail(cache != NULL, NULL);
+    g_return_val_if_fail(name != NULL, NULL);
+
+    set = g_hash_table_lookup(cache->name_table, name);
+    if (set) {
+        self = set->images->data;
+        RrImageRef(self);
+        return self;
+    }
+
+    /* XXX find the path via freedesktop icon spec (use obt) ! */
+    path = g_strdup(name);
+
+#if defined(USE_LIBRSVG) || defined(USE_IMLIB2)
+    /* when the file isn't there, don't give out an image that will never
+       have a picture in it */
+    if (g_file_test(path, G_FILE_TEST_IS_REGULAR)) {
+        /* make a new RrImage with the name, and load the picture into it.
+           when it is loaded, it may be merged with an RrImageSet that
+           already has the same picture.
+
+           because of the check above, we know that there is no RrImageSet
+           in the cache which already has the given name asosciated with it.
+        */
+        self = RrImageNewEmpty(cache);
+        RrImageSetAddName(self->set, name);
+        load_start(self, path);
+        return self;
+    }
 #endif
 
-    return self;
+    g_message("Cannot load image \"%s\" from file \"%s\"", name, path);
+    g_free(path);
+    return NULL;
 }
 
 /************************************************************************
@@ -896,6 +1172,30 @@ void RrImageDrawRGBA(RrPixel32 *target, RrTextureRGBA *rgba,
                  rgba->alpha, area);
 }
 
+void RrImageCacheTrim(RrImageCache *self, const RrImagePic *keep)
+{
+    while (self->max_resized_bytes &&
+           self->resized_bytes > self->max_resized_bytes)
+    {
+        RrImagePic *pic = g_queue_peek_tail(&self->resized_lru);
+        RrImageSet *set = pic->set;
+        gint i;
+
+        if (pic == keep) break; /* it's the only one left */
+
+        for (i = 0; i < set->n_resized && set->resized[i] != pic; ++i);
+        if (i < set->n_resized)
+            RrImageSetRemovePictureAt(set, i, FALSE);
+        else {
+            /* it isn't in its set, which should never happen.  skip it, and
+               stop counting it so this can't loop forever */
+            g_warn_if_reached();
+            RrImageCacheRemovePicture(self, pic);
+        }
+        ++self->evictions;
+    }
+}
+
 /*! Draw an RrImage texture into a target pixel buffer.  If the RrImage does
   not contain a picture of the appropriate size, then one of its "original"
   pictures will be resized and used (and stored in the RrImage as a "resized"
@@ -916,6 +1216,10 @@ void RrImageDrawImage(RrPixel32 *target, RrTextureImage *img,
     pic = NULL;
     free_pic = FALSE;
 
+    /* it is still being loaded */
+    if (!set->n_original)
+        return;
+
     /* is there an original of this size? (only the larger of
        w or h has to be right cuz we maintain aspect ratios) */
     for (i = 0; i < set->n_original; ++i)
@@ -949,10 +1253,14 @@ void RrImageDrawImage(RrPixel32 *target, RrTextureImage *img,
             set->resized[0] = saved;
 
             pic = set->resized[0];
+            RrImageCacheTouchPicture(set->cache, pic);
             break;
         }
 
-    if (!pic) {
+    ++set->cache->lookups;
+    if (pic)
+        ++set->cache->hits;
+    else {
         gdouble aspect;
         RrImageSet *cache_set;
 
@@ -1015,9 +1323,12 @@ void RrImageDrawImage(RrPixel32 *target, RrTextureImage *img,
                 /* remove the last one (last used one) to make space for
                  adding our resized picture */
                 RrImageSetRemovePictureAt(set, set->n_resized-1, FALSE);
-            if (set->cache->max_resized_saved)
-                /* add it to the resized list */
+            if (set->cache->max_resized_saved) {
+                /* add it to the resized list, and make room for it in the
+                   cache */
                 RrImageSetAddPicture(set, pic, FALSE);
+                RrImageCacheTrim(set->cache, pic);
+            }
             else
                 free_pic = TRUE; /* don't leak mem! */
         }
@@ -29,4 +29,14 @@ void RrImageDrawRGBA(RrPixel32 *target, RrTextureRGBA *rgba,
                      gint target_w, gint target_h,
                      RrRect *area);
 
+/*! Throws away the least recently used resized pictures in the cache until
+  they fit in its budget.
+  @param keep A picture which is not thrown away, or NULL
+*/
+void RrImageCacheTrim(RrImageCache *self, const RrImagePic *keep);
+
+/*! Waits for the images which are being loaded by name, and adds their
+  pictures to them */
+void RrImageLoadWait(void);
+
 #endif
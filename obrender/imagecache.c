@@ -35,6 +35,13 @@ RrImageCache* RrImageCacheNew(gint max_resized_saved)
     self->pic_table = g_hash_table_new((GHashFunc)RrImagePicHash,
                                        (GEqualFunc)RrImagePicEqual);
     self->name_table = g_hash_table_new(g_str_hash, g_str_equal);
+    self->max_resized_bytes = 0;
+    g_queue_init(&self->resized_lru);
+    self->pictures = 0;
+    self->bytes = self->resized_bytes = 0;
+    self->lookups = self->hits = self->evictions = 0;
+    self->loaded_func = NULL;
+    self->loaded_data = NULL;
     return self;
 }
 
@@ -43,10 +50,136 @@ void RrImageCacheRef(RrImageCache *self)
     ++self->ref;
 }
 
+void RrImageCacheSetLoadedFunc(RrImageCache *self, RrImageLoadedFunc func,
+                               gpointer data)
+{
+    self->loaded_func = func;
+    self->loaded_data = data;
+}
+
+void RrImageCacheSetMaxResizedBytes(RrImageCache *self, gsize max_bytes)
+{
+    self->max_resized_bytes = max_bytes;
+    RrImageCacheTrim(self, NULL);
+}
+
+static gsize pic_bytes(const RrImagePic *pic)
+{
+    return (gsize)pic->width * pic->height * sizeof(RrPixel32);
+}
+
+void RrImageCacheAddPicture(RrImageCache *self, RrImagePic *pic,
+                            RrImageSet *set, gboolean resized)
+{
+    pic->set = set;
+    g_hash_table_insert(self->pic_table, pic, set);
+    ++self->pictures;
+    self->bytes += pic_bytes(pic);
+    if (resized) {
+        g_queue_push_head(&self->resized_lru, pic);
+        pic->lru = self->resized_lru.head;
+        self->resized_bytes += pic_bytes(pic);
+    }
+}
+
+void RrImageCacheRemovePicture(RrImageCache *self, RrImagePic *pic)
+{
+    gpointer key;
+
+    /* the table is keyed by the picture's contents, so only remove the
+       entry if it is for this picture and not another one which looks the
+       same */
+    if (g_hash_table_lookup_extended(self->pic_table, pic, &key, NULL) &&
+        key == pic)
+        g_hash_table_remove(self->pic_table, pic);
+    --self->pictures;
+    self->bytes -= pic_bytes(pic);
+    if (pic->lru) {
+        g_queue_delete_link(&self->resized_lru, pic->lru);
+        pic->lru = NULL;
+        self->resized_bytes -= pic_bytes(pic);
+    }
+}
+
+void RrImageCacheTouchPicture(RrImageCache *self, RrImagePic *pic)
+{
+    if (pic->lru && pic->lru != self->resized_lru.head) {
+        g_queue_unlink(&self->resized_lru, pic->lru);
+        g_queue_push_head_link(&self->resized_lru, pic->lru);
+    }
+}
+
+void RrImageCacheGetStats(const RrImageCache *self, RrImageCacheStats *stats)
+{
+    stats->pictures = self->pictures;
+    stats->bytes = self->bytes;
+    stats->resized = self->resized_lru.length;
+    stats->resized_bytes = self->resized_bytes;
+    stats->lookups = self->lookups;
+    stats->hits = self->hits;
+    stats->evictions = self->evictions;
+}
+
+static void dump_pics(GString *out, const gchar *kind, RrImagePic **pics,
+                      gint n, const GQueue *lru)
+{
+    gint i;
+
+    for (i = 0; i < n; ++i) {
+        g_string_append_printf(out, "  %s %dx%d", kind,
+                               pics[i]->width, pics[i]->height);
+        if (pics[i]->lru)
+            g_string_append_printf(out, " lru %d",
+                                   g_queue_link_index((GQueue*)lru,
+                                                      pics[i]->lru));
+        g_string_append_c(out, '\n');
+    }
+}
+
+void RrImageCacheDump(const RrImageCache *self, GString *out)
+{
+    GHashTable *seen;
+    GHashTableIter it;
+    gpointer set;
+
+    g_string_append_printf(out, "%u pictures, %" G_GSIZE_FORMAT " bytes, "
+                           "%u resized, %" G_GSIZE_FORMAT " bytes of %"
+                           G_GSIZE_FORMAT " allowed\n",
+                           self->pictures, self->bytes,
+                           self->resized_lru.length, self->resized_bytes,
+                           self->max_resized_bytes);
+
+    /* every picture in a set is a key for it, so list each set once */
+    seen = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_hash_table_iter_init(&it, self->pic_table);
+    while (g_hash_table_iter_next(&it, NULL, &set)) {
+        const RrImageSet *s = set;
+        GSList *n;
+
+        if (g_hash_table_lookup(seen, set)) continue;
+        g_hash_table_insert(seen, set, set);
+
+        g_string_append_printf(out, "image %p used %u", set,
+                               g_slist_length(s->images));
+        for (n = s->names; n; n = g_slist_next(n))
+            g_string_append_printf(out, " %s", (gchar*)n->data);
+        g_string_append_c(out, '\n');
+        dump_pics(out, "original", s->original, s->n_original,
+                  &self->resized_lru);
+        dump_pics(out, "resized", s->resized, s->n_resized,
+                  &self->resized_lru);
+    }
+    g_hash_table_destroy(seen);
+}
+
 void RrImageCacheUnref(RrImageCache *self)
 {
     if (self && --self->ref == 0) {
+        /* the images being loaded are still holding their RrImageSets */
+        RrImageLoadWait();
+
         g_assert(g_hash_table_size(self->pic_table) == 0);
+        g_assert(g_queue_is_empty(&self->resized_lru));
         g_hash_table_unref(self->pic_table);
         self->pic_table = NULL;
 
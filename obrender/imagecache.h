@@ -53,6 +53,41 @@ struct _RrImageCache {
     /*! Used to find out if an image file has already been loaded into an
       image set. Provides a quick file_name -> RrImageSet lookup. */
     GHashTable *name_table;
+
+    /*! The most bytes of resized pictures to keep across all of the images,
+      or 0 for no limit. */
+    gsize max_resized_bytes;
+
+    /*! The resized pictures in every image, from most to least recently
+      used. */
+    GQueue resized_lru;
+
+    /*! The pictures held by the image sets, and the bytes of picture data in
+      them, and how much of that is in resized pictures */
+    guint pictures;
+    gsize bytes;
+    gsize resized_bytes;
+
+    /*! How many times an image was drawn, and how many of those found a
+      picture of the right size without resizing one */
+    guint lookups;
+    guint hits;
+    /*! How many resized pictures were thrown away to stay in the budget */
+    guint evictions;
+
+    /*! Called when an image loaded by name gets its picture */
+    RrImageLoadedFunc loaded_func;
+    gpointer loaded_data;
 };
 
+/*! Adds a picture in an image set to the cache's pic_table, and counts its
+  bytes.  Resized pictures become the most recently used. */
+void RrImageCacheAddPicture(RrImageCache *self, struct _RrImagePic *pic,
+                            struct _RrImageSet *set, gboolean resized);
+/*! Removes a picture from the cache's pic_table, and stops counting it.  It
+  does not free the picture. */
+void RrImageCacheRemovePicture(RrImageCache *self, struct _RrImagePic *pic);
+/*! Marks a resized picture as the most recently used */
+void RrImageCacheTouchPicture(RrImageCache *self, struct _RrImagePic *pic);
+
 #endif
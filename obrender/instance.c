@@ -24,6 +24,9 @@ static RrInstance *definst = NULL;
 
 static void RrTrueColorSetup (RrInstance *inst);
 static void RrPseudoColorSetup (RrInstance *inst);
+#ifdef USE_XRENDER
+static void RrRenderSetup (RrInstance *inst);
+#endif
 
 #ifdef DEBUG
 #include "color.h"
@@ -72,9 +75,16 @@ RrInstance* RrInstanceNew (Display *display, gint screen)
     definst->color_hash = g_hash_table_new_full(g_int_hash, g_int_equal,
                                                 NULL, dest);
 
+#ifdef USE_XRENDER
+    definst->render_format = NULL;
+#endif
+
     switch (definst->visual->class) {
     case TrueColor:
         RrTrueColorSetup(definst);
+#ifdef USE_XRENDER
+        RrRenderSetup(definst);
+#endif
         break;
     case PseudoColor:
     case StaticColor:
@@ -118,6 +128,22 @@ static void RrTrueColorSetup (RrInstance *inst)
   XFree(timage);
 }
 
+#ifdef USE_XRENDER
+static void RrRenderSetup (RrInstance *inst)
+{
+    gint event, error, major, minor;
+
+    /* gradients were added in version 0.10 of the extension */
+    if (XRenderQueryExtension(inst->display, &event, &error) &&
+        XRenderQueryVersion(inst->display, &major, &minor) &&
+        (major > 0 || minor >= 10))
+    {
+        inst->render_format = XRenderFindVisualFormat(inst->display,
+                                                      inst->visual);
+    }
+}
+#endif
+
 #define RrPseudoNcolors(inst) (1 << (inst->pseudo_bpc * 3))
 
 static void RrPseudoColorSetup (RrInstance *inst)
@@ -302,6 +328,13 @@ XColor *RrPseudoColors (const RrInstance *inst)
     return (inst ? inst : definst)->pseudo_colors;
 }
 
+#ifdef USE_XRENDER
+XRenderPictFormat *RrRenderFormat (const RrInstance *inst)
+{
+    return (inst ? inst : definst)->render_format;
+}
+#endif
+
 GHashTable* RrColorHash (const RrInstance *inst)
 {
     return (inst ? inst : definst)->color_hash;
@@ -22,6 +22,9 @@
 #include <X11/Xlib.h>
 #include <glib.h>
 #include <pango/pangoxft.h>
+#ifdef USE_XRENDER
+#include <X11/extensions/Xrender.h>
+#endif
 
 struct _RrInstance {
     Display *display;
@@ -49,10 +52,19 @@ struct _RrInstance {
     XColor *pseudo_colors;
 
     GHashTable *color_hash;
+
+#ifdef USE_XRENDER
+    /* the format for drawing to pixmaps with the X Render extension, or NULL
+       if the server can't draw gradients */
+    XRenderPictFormat *render_format;
+#endif
 };
 
 guint       RrPseudoBPC    (const RrInstance *inst);
 XColor*     RrPseudoColors (const RrInstance *inst);
 GHashTable* RrColorHash    (const RrInstance *inst);
+#ifdef USE_XRENDER
+XRenderPictFormat* RrRenderFormat (const RrInstance *inst);
+#endif
 
 #endif
@@ -0,0 +1,209 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   prerender.c for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "prerender.h"
+#include "gradient.h"
+
+#include <string.h>
+
+typedef struct _RrPrerenderJob RrPrerenderJob;
+
+struct _RrPrerenderJob {
+    RrPrerender *owner;
+    /* NULL if the appearance was freed */
+    RrAppearance *a;
+    gint w, h;
+    /* NULL until the job has been run */
+    RrPixel32 *data;
+};
+
+struct _RrPrerender {
+    GPtrArray *jobs;
+
+    /* the number of jobs still running in the pool */
+    gint left;
+    GMutex lock;
+    GCond done;
+};
+
+static GThreadPool *pool = NULL;
+static gint pool_threads = 0;
+
+/*! The number of threads to use when none was configured */
+static gint default_threads(void)
+{
+#if GLIB_CHECK_VERSION(2,36,0)
+    return (gint)g_get_num_processors();
+#else
+    /* older glib can't count the processors, so render serially unless
+       the user asked for threads */
+    return 1;
+#endif
+}
+
+static void run_job(gpointer data, gpointer user_data)
+{
+    RrPrerenderJob *job = data;
+    RrPrerender *p = job->owner;
+    RrPixel32 *pixels;
+
+    /* every job writes only to its own pixels, so the results are the same
+       no matter how the jobs are spread across the threads */
+    pixels = g_new(RrPixel32, job->w * job->h);
+    RrRenderPixels(job->a, job->w, job->h, pixels);
+
+    g_mutex_lock(&p->lock);
+    job->data = pixels;
+    if (--p->left == 0)
+        g_cond_signal(&p->done);
+    g_mutex_unlock(&p->lock);
+}
+
+void RrPrerenderSetThreads(gint n)
+{
+    pool_threads = MAX(n, 0);
+    if (pool)
+        g_thread_pool_set_max_threads(pool, (pool_threads ? pool_threads :
+                                             default_threads()),
+                                      NULL);
+}
+
+RrPrerender* RrPrerenderNew(void)
+{
+    RrPrerender *p;
+
+    p = g_slice_new(RrPrerender);
+    p->jobs = g_ptr_array_new();
+    p->left = 0;
+    g_mutex_init(&p->lock);
+    g_cond_init(&p->done);
+    return p;
+}
+
+void RrPrerenderAdd(RrPrerender *p, RrAppearance *a, gint w, gint h)
+{
+    RrPrerenderJob *job;
+    GSList *it;
+
+    if (w <= 0 || h <= 0) return;
+
+    /* parent relative surfaces are copied from their parent when they are
+       painted, and the X server draws the others itself */
+    if (a->surface.grad == RR_SURFACE_PARENTREL ||
+        RrRenderServerSupported(a, w, h))
+        return;
+
+    for (it = a->prerendered; it; it = g_slist_next(it)) {
+        job = it->data;
+        if (job->w == w && job->h == h)
+            return; /* already going to be rendered at this size */
+    }
+
+    job = g_slice_new(RrPrerenderJob);
+    job->owner = p;
+    job->a = a;
+    job->w = w;
+    job->h = h;
+    job->data = NULL;
+    g_ptr_array_add(p->jobs, job);
+    a->prerendered = g_slist_prepend(a->prerendered, job);
+}
+
+void RrPrerenderRun(RrPrerender *p)
+{
+    guint i;
+    gint threads;
+
+    threads = pool_threads ? pool_threads : default_threads();
+
+    /* not worth handing out to other threads */
+    if (threads < 2 || p->jobs->len < 2) {
+        for (i = 0; i < p->jobs->len; ++i) {
+            RrPrerenderJob *job = g_ptr_array_index(p->jobs, i);
+            if (job->a && !job->data) {
+                ++p->left;
+                run_job(job, NULL);
+            }
+        }
+        return;
+    }
+
+    if (!pool)
+        pool = g_thread_pool_new(run_job, NULL, threads, FALSE, NULL);
+
+    g_mutex_lock(&p->lock);
+    for (i = 0; i < p->jobs->len; ++i) {
+        RrPrerenderJob *job = g_ptr_array_index(p->jobs, i);
+        if (job->a && !job->data) {
+            ++p->left;
+            g_thread_pool_push(pool, job, NULL);
+        }
+    }
+    while (p->left > 0)
+        g_cond_wait(&p->done, &p->lock);
+    g_mutex_unlock(&p->lock);
+}
+
+void RrPrerenderFree(RrPrerender *p)
+{
+    guint i;
+
+    if (!p) return;
+
+    for (i = 0; i < p->jobs->len; ++i) {
+        RrPrerenderJob *job = g_ptr_array_index(p->jobs, i);
+        if (job->a)
+            job->a->prerendered = g_slist_remove(job->a->prerendered, job);
+        g_free(job->data);
+        g_slice_free(RrPrerenderJob, job);
+    }
+    g_ptr_array_free(p->jobs, TRUE);
+    g_mutex_clear(&p->lock);
+    g_cond_clear(&p->done);
+    g_slice_free(RrPrerender, p);
+}
+
+gboolean RrPrerenderTake(RrAppearance *a, gint w, gint h)
+{
+    GSList *it;
+
+    for (it = a->prerendered; it; it = g_slist_next(it)) {
+        RrPrerenderJob *job = it->data;
+
+        /* the surface is copied so it can be used for every window that is
+           painted at this size */
+        if (job->data && job->w == w && job->h == h) {
+            memcpy(a->surface.pixel_data, job->data,
+                   w * h * sizeof(RrPixel32));
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void RrPrerenderForget(RrAppearance *a)
+{
+    GSList *it;
+
+    for (it = a->prerendered; it; it = g_slist_next(it)) {
+        RrPrerenderJob *job = it->data;
+        job->a = NULL;
+    }
+    g_slist_free(a->prerendered);
+    a->prerendered = NULL;
+}
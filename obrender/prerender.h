@@ -0,0 +1,30 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   prerender.h for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __prerender_h
+#define __prerender_h
+
+#include "render.h"
+
+/*! Fill in the appearance's pixel_data from a prerendered surface of the
+  given size.  Returns FALSE if there isn't one */
+gboolean RrPrerenderTake(RrAppearance *a, gint w, gint h);
+/*! Stop any prerender from using the appearance, because it is being freed */
+void RrPrerenderForget(RrAppearance *a);
+
+#endif
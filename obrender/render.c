@@ -25,6 +25,7 @@
 #include "color.h"
 #include "image.h"
 #include "theme.h"
+#include "prerender.h"
 
 #include <glib.h>
 #include <X11/Xlib.h>
@@ -37,16 +38,24 @@
 
 static void pixel_data_to_pixmap(RrAppearance *l,
                                  gint x, gint y, gint w, gint h);
+static void free_spare(RrAppearance *a);
 
-Pixmap RrPaintPixmap(RrAppearance *a, gint w, gint h)
+static guint paint_count = 0;
+
+/*! Paint into the appearance.  If reuse is TRUE then the appearance's pixmap
+  is not used by anything except the window being painted, and painting at the
+  same size swaps it with the spare buffer rather than making a new pixmap */
+static Pixmap paint_pixmap(RrAppearance *a, gint w, gint h, gboolean reuse)
 {
     gint i, transferred = 0, force_transfer = 0;
     Pixmap oldp = None;
     RrRect tarea; /* area in which to draw textures */
-    gboolean resized;
+    gboolean resized, upload;
 
     if (w <= 0 || h <= 0) return None;
 
+    ++paint_count;
+
     if (a->surface.parentx < 0 || a->surface.parenty < 0) {
         /* ob_debug("Invalid parent co-ordinates\n"); */
         return None;
@@ -61,27 +70,73 @@ Pixmap RrPaintPixmap(RrAppearance *a, gint w, gint h)
 
     resized = (a->w != w || a->h != h);
 
-    oldp = a->pixmap; /* save to free after changing the visible pixmap */
-    a->pixmap = XCreatePixmap(RrDisplay(a->inst),
-                              RrRootWindow(a->inst),
-                              w, h, RrDepth(a->inst));
+    if (reuse && !resized && a->pixmap != None) {
+        Pixmap front = a->pixmap;
+        XftDraw *frontdraw = a->xftdraw;
+
+        /* draw into the back buffer while the window keeps showing the old
+           pixmap, which then becomes the back buffer */
+        if (a->spare == None) {
+            a->spare = XCreatePixmap(RrDisplay(a->inst),
+                                     RrRootWindow(a->inst),
+                                     w, h, RrDepth(a->inst));
+            g_assert(a->spare != None);
+        }
+        if (a->spare_xftdraw == NULL) {
+            a->spare_xftdraw = XftDrawCreate(RrDisplay(a->inst), a->spare,
+                                             RrVisual(a->inst),
+                                             RrColormap(a->inst));
+            g_assert(a->spare_xftdraw != NULL);
+        }
+        a->pixmap = a->spare;
+        a->xftdraw = a->spare_xftdraw;
+        a->spare = front;
+        a->spare_xftdraw = frontdraw;
+        oldp = None;
+    }
+    else {
+        oldp = a->pixmap; /* save to free after changing the visible pixmap */
+        a->pixmap = XCreatePixmap(RrDisplay(a->inst),
+                                  RrRootWindow(a->inst),
+                                  w, h, RrDepth(a->inst));
+        g_assert(a->pixmap != None);
+
+        /* the XftDraw can follow the pixmap instead of being made again */
+        if (a->xftdraw != NULL)
+            XftDrawChange(a->xftdraw, a->pixmap);
+        else
+            a->xftdraw = XftDrawCreate(RrDisplay(a->inst), a->pixmap,
+                                       RrVisual(a->inst),
+                                       RrColormap(a->inst));
+        g_assert(a->xftdraw != NULL);
+
+        /* the spare buffer has to stay the same size as the pixmap */
+        if (resized)
+            free_spare(a);
+    }
 
-    g_assert(a->pixmap != None);
     a->w = w;
     a->h = h;
 
-    if (a->xftdraw != NULL)
-        XftDrawDestroy(a->xftdraw);
-    a->xftdraw = XftDrawCreate(RrDisplay(a->inst), a->pixmap,
-                               RrVisual(a->inst), RrColormap(a->inst));
-    g_assert(a->xftdraw != NULL);
-
     if (resized) {
         g_free(a->surface.pixel_data);
         a->surface.pixel_data = g_new(RrPixel32, w * h);
     }
 
-    RrRender(a, w, h);
+    if (RrRenderServerSupported(a, w, h)) {
+        RrRenderServer(a, w, h);
+        a->surface.pixel_data_stale = TRUE;
+        upload = FALSE;
+    }
+    else {
+        /* use the surface from a prerender if there is one */
+        if (!RrPrerenderTake(a, w, h))
+            RrRender(a, w, h);
+        a->surface.pixel_data_stale = FALSE;
+        /* solid surfaces were drawn straight into the pixmap already */
+        upload = (a->surface.grad != RR_SURFACE_SOLID ||
+                  a->surface.interlaced);
+    }
 
     {
         gint l, t, r, b;
@@ -96,8 +151,7 @@ Pixmap RrPaintPixmap(RrAppearance *a, gint w, gint h)
         case RR_TEXTURE_TEXT:
             if (!transferred) {
                 transferred = 1;
-                if ((a->surface.grad != RR_SURFACE_SOLID)
-                    || (a->surface.interlaced))
+                if (upload)
                     pixel_data_to_pixmap(a, 0, 0, w, h);
             }
             if (a->xftdraw == NULL) {
@@ -110,8 +164,7 @@ Pixmap RrPaintPixmap(RrAppearance *a, gint w, gint h)
         case RR_TEXTURE_LINE_ART:
             if (!transferred) {
                 transferred = 1;
-                if ((a->surface.grad != RR_SURFACE_SOLID)
-                    || (a->surface.interlaced))
+                if (upload)
                     pixel_data_to_pixmap(a, 0, 0, w, h);
             }
             XDrawLine(RrDisplay(a->inst), a->pixmap,
@@ -124,8 +177,7 @@ Pixmap RrPaintPixmap(RrAppearance *a, gint w, gint h)
         case RR_TEXTURE_MASK:
             if (!transferred) {
                 transferred = 1;
-                if ((a->surface.grad != RR_SURFACE_SOLID)
-                    || (a->surface.interlaced))
+                if (upload)
                     pixel_data_to_pixmap(a, 0, 0, w, h);
             }
             RrPixmapMaskDraw(a->pixmap, &a->texture[i].data.mask, &tarea);
@@ -177,27 +229,53 @@ Pixmap RrPaintPixmap(RrAppearance *a, gint w, gint h)
 
     if (!transferred) {
         transferred = 1;
-        if ((a->surface.grad != RR_SURFACE_SOLID) || (a->surface.interlaced) ||
-            force_transfer)
-        {
+        if (upload || force_transfer)
             pixel_data_to_pixmap(a, 0, 0, w, h);
-        }
     }
 
     return oldp;
 }
 
+guint RrPaintCount(void)
+{
+    return paint_count;
+}
+
+Pixmap RrPaintPixmap(RrAppearance *a, gint w, gint h)
+{
+    /* the caller can do anything with the pixmap, so it can't be drawn into
+       again */
+    a->painted = None;
+    return paint_pixmap(a, w, h, FALSE);
+}
+
 void RrPaint(RrAppearance *a, Window win, gint w, gint h)
 {
-    Pixmap oldp;
+    Pixmap oldp, p;
 
-    oldp = RrPaintPixmap(a, w, h);
+    p = a->pixmap;
+    oldp = paint_pixmap(a, w, h, a->painted == win);
+    /* if nothing was painted then the window is given a pixmap that other
+       windows may be using too */
+    a->painted = (a->pixmap != p ? win : None);
     XSetWindowBackgroundPixmap(RrDisplay(a->inst), win, a->pixmap);
     XClearWindow(RrDisplay(a->inst), win);
     /* free this after changing the visible pixmap */
     if (oldp) XFreePixmap(RrDisplay(a->inst), oldp);
 }
 
+static void free_spare(RrAppearance *a)
+{
+    if (a->spare != None) {
+        XFreePixmap(RrDisplay(a->inst), a->spare);
+        a->spare = None;
+    }
+    if (a->spare_xftdraw != NULL) {
+        XftDrawDestroy(a->spare_xftdraw);
+        a->spare_xftdraw = NULL;
+    }
+}
+
 RrAppearance *RrAppearanceNew(const RrInstance *inst, gint numtex)
 {
   RrAppearance *out;
@@ -308,6 +386,7 @@ RrAppearance *RrAppearanceCopy(RrAppearance *orig)
     spc->parent = NULL;
     spc->parentx = spc->parenty = 0;
     spc->pixel_data = NULL;
+    spc->pixel_data_stale = FALSE;
 
     copy->textures = orig->textures;
     copy->texture = g_memdup(orig->texture,
@@ -315,6 +394,10 @@ RrAppearance *RrAppearanceCopy(RrAppearance *orig)
     copy->pixmap = None;
     copy->xftdraw = NULL;
     copy->w = copy->h = 0;
+    copy->spare = None;
+    copy->spare_xftdraw = NULL;
+    copy->painted = None;
+    copy->prerendered = NULL;
     return copy;
 }
 
@@ -325,6 +408,8 @@ void RrAppearanceFree(RrAppearance *a)
         RrSurface *p;
         if (a->pixmap != None) XFreePixmap(RrDisplay(a->inst), a->pixmap);
         if (a->xftdraw != NULL) XftDrawDestroy(a->xftdraw);
+        free_spare(a);
+        RrPrerenderForget(a);
         if (a->textures)
             g_free(a->texture);
         p = &a->surface;
@@ -34,6 +34,8 @@ typedef union  _RrTextureData      RrTextureData;
 typedef struct _RrAppearance       RrAppearance;
 typedef struct _RrSurface          RrSurface;
 typedef struct _RrFont             RrFont;
+typedef struct _RrFontCacheStats   RrFontCacheStats;
+typedef struct _RrPrerender        RrPrerender;
 typedef struct _RrTexture          RrTexture;
 typedef struct _RrTextureMask      RrTextureMask;
 typedef struct _RrTextureRGBA      RrTextureRGBA;
@@ -47,6 +49,7 @@ typedef struct _RrImage            RrImage;
 typedef struct _RrImageSet         RrImageSet;
 typedef struct _RrImagePic         RrImagePic;
 typedef struct _RrImageCache       RrImageCache;
+typedef struct _RrImageCacheStats  RrImageCacheStats;
 typedef struct _RrButton           RrButton;
 
 typedef guint32 RrPixel32;  /* ARGB format, not premultiplied alpha */
@@ -138,12 +141,24 @@ struct _RrSurface {
     gint parentx;
     gint parenty;
     RrPixel32 *pixel_data;
+    /* the surface was drawn by the X server and pixel_data wasn't filled in,
+       it is only filled in when a parent relative child needs it */
+    gboolean pixel_data_stale;
     gint bevel_dark_adjust;  /* 0-255, default is 64 */
     gint bevel_light_adjust; /* 0-255, default is 128 */
     RrColor *split_primary;
     RrColor *split_secondary;
 };
 
+/*! How well the caches of measured and drawn strings in an RrFont are
+  working */
+struct _RrFontCacheStats {
+    guint extents_lookups;
+    guint extents_hits;
+    guint layout_lookups;
+    guint layout_hits;
+};
+
 struct _RrTextureText {
     RrFont *font;
     RrJustify justify;
@@ -231,6 +246,14 @@ struct _RrAppearance {
 
     /* cached for internal use */
     gint w, h;
+    /* a second buffer the same size as pixmap, which is drawn into when the
+       appearance is painted again for the same window */
+    Pixmap spare;
+    XftDraw *spare_xftdraw;
+    /* the window using pixmap as its background, if it is the only one */
+    Window painted;
+    /* surfaces rendered ahead of time by RrPrerenderRun */
+    GSList *prerendered;
 };
 
 /*! Holds a RGBA image picture */
@@ -240,9 +263,15 @@ struct _RrImagePic {
     /* The sum of all the pixels.  This is used to compare pictures if their
        hashes match. */
     gint sum;
+    /* For a resized picture, its place in the cache's list of resized
+       pictures, from most to least recently used */
+    GList *lru;
+    /* The RrImageSet which holds the picture */
+    RrImageSet *set;
 };
 
 typedef void (*RrImageDestroyFunc)(RrImage *image, gpointer data);
+typedef void (*RrImageLoadedFunc)(RrImage *image, gpointer data);
 
 /*! An RrImage refers to a RrImageSet.  If multiple RrImageSets end up
   holding the same image data, they will be marged and the RrImages that
@@ -287,6 +316,20 @@ struct _RrImageSet
     gint n_resized;
 };
 
+/*! How much an RrImageCache is holding, and how often drawing an image
+  found a picture of the right size already in it */
+struct _RrImageCacheStats {
+    guint pictures;
+    gsize bytes;
+    /*! The part of the pictures which are resized copies */
+    guint resized;
+    gsize resized_bytes;
+    guint lookups;
+    guint hits;
+    /*! Resized pictures thrown away to stay inside the byte budget */
+    guint evictions;
+};
+
 struct _RrButton {
     const RrInstance *inst;
 
@@ -397,12 +440,26 @@ RrSize *RrFontMeasureString (const RrFont *f, const gchar *str,
                              gboolean flow, gint maxwidth);
 gint    RrFontHeight        (const RrFont *f, gint shadow_offset_y);
 gint    RrFontMaxCharWidth  (const RrFont *f);
+void    RrFontGetCacheStats (const RrFont *f, RrFontCacheStats *stats);
 
 /* Paint into the appearance. The old pixmap is returned (if there was one). It
    is the responsibility of the caller to call XFreePixmap on the return when
    it is non-null. */
 Pixmap RrPaintPixmap (RrAppearance *a, gint w, gint h);
 void   RrPaint       (RrAppearance *a, Window win, gint w, gint h);
+/* The number of times an appearance has been painted */
+guint  RrPaintCount  (void);
+
+/* Render the surfaces of many appearances at once, spread over a pool of
+   threads.  Add each appearance with the size it will be painted at, then
+   run the prerender, and painting them at those sizes uses the surfaces that
+   were already rendered, until the prerender is freed. */
+RrPrerender* RrPrerenderNew  (void);
+void         RrPrerenderAdd  (RrPrerender *p, RrAppearance *a, gint w, gint h);
+void         RrPrerenderRun  (RrPrerender *p);
+void         RrPrerenderFree (RrPrerender *p);
+/* Set how many threads prerendering uses, or 0 for one per processor */
+void         RrPrerenderSetThreads (gint n);
 void   RrMinSize     (RrAppearance *a, gint *w, gint *h);
 gint   RrMinWidth    (RrAppearance *a);
 /* For text textures, if flow is TRUE, then the string must be set before
@@ -420,8 +477,28 @@ gboolean RrPixmapToRGBA(const RrInstance *inst,
 RrImageCache* RrImageCacheNew(gint max_resized_saved);
 void          RrImageCacheRef(RrImageCache *self);
 void          RrImageCacheUnref(RrImageCache *self);
+void          RrImageCacheGetStats(const RrImageCache *self,
+                                   RrImageCacheStats *stats);
+/*! Limit the memory used by resized pictures across all of the images in the
+  cache.  When it is exceeded, the least recently used resized pictures are
+  thrown away.
+  @param max_bytes The most bytes of resized picture data to keep, or 0 for
+    no limit
+*/
+void          RrImageCacheSetMaxResizedBytes(RrImageCache *self,
+                                             gsize max_bytes);
+/*! Set a function to be called when an image from RrImageNewFromName
+  has been loaded, so that whatever is showing it can be drawn again */
+void          RrImageCacheSetLoadedFunc(RrImageCache *self,
+                                        RrImageLoadedFunc func,
+                                        gpointer data);
+/*! Appends a description of every image in the cache and the pictures it
+  holds to the string, for debugging */
+void          RrImageCacheDump(const RrImageCache *self, GString *out);
 
 /*! Create a new image, or return one from the cache that matches.
+  The picture is loaded in the background, and the image draws nothing until
+  it is done.  See RrImageCacheSetLoadedFunc.
   @param cache The image cache.
   @param old The current RrImage, which the new image should be added to.
     Use this if loading a different sized version of the same image.
@@ -39,6 +39,7 @@ extern void xqueue_destroy(void);
 Display* obt_display = NULL;
 
 gboolean obt_display_error_occured = FALSE;
+gint obt_display_round_trips = 0;
 
 gboolean obt_display_extension_xkb       = FALSE;
 gint     obt_display_extension_xkb_basep;
@@ -160,6 +161,7 @@ static gint xerror_handler(Display *d, XErrorEvent *e)
 void obt_display_ignore_errors(gboolean ignore)
 {
     XSync(obt_display, FALSE);
+    obt_display_round_trip();
     xerror_ignore = ignore;
     if (ignore) obt_display_error_occured = FALSE;
 }
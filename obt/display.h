@@ -56,6 +56,11 @@ extern gint     obt_display_extension_sync_basep;
 
 extern Display* obt_display;
 
+/*! The number of times Obt has waited for a reply from the X server */
+extern gint obt_display_round_trips;
+/*! Count a round trip to the X server */
+#define obt_display_round_trip() g_atomic_int_inc(&obt_display_round_trips)
+
 /*! Open the X display.  You should call g_set_prgname() before calling this
   function for X Input Methods to work correctly. */
 gboolean obt_display_open(const char *display_name);
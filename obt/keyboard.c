@@ -43,12 +43,16 @@ struct _ObtIC
 
 static void set_modkey_mask(guchar mask, KeySym sym);
 static void xim_init(void);
+static void keysym_codes_build(void);
 void obt_keyboard_shutdown();
 void obt_keyboard_context_renew(ObtIC *ic);
 
 static XModifierKeymap *modmap;
 static KeySym *keymap;
 static gint min_keycode, max_keycode, keysyms_per_keycode;
+/*! Maps a KeySym to a zero-terminated GArray of the KeyCodes which generate
+  it, so they don't need to be searched for in the keymap */
+static GHashTable *keysym_codes;
 /*! This is a bitmask of the different masks for each modifier key */
 static guchar modkeys_keys[OBT_KEYBOARD_NUM_MODKEYS];
 
@@ -84,6 +88,7 @@ void obt_keyboard_reload(void)
     keymap = XGetKeyboardMapping(obt_display, min_keycode,
                                  max_keycode - min_keycode + 1,
                                  &keysyms_per_keycode);
+    keysym_codes_build();
 
     alt_l = meta_l = super_l = hyper_l = FALSE;
 
@@ -122,6 +127,8 @@ void obt_keyboard_shutdown(void)
     modmap = NULL;
     XFree(keymap);
     keymap = NULL;
+    if (keysym_codes) g_hash_table_destroy(keysym_codes);
+    keysym_codes = NULL;
     for (it = xic_all; it; it = g_slist_next(it)) {
         ObtIC* ic = it->data;
         if (ic->xic) {
@@ -266,24 +273,76 @@ static void set_modkey_mask(guchar mask, KeySym sym)
     /* CapsLock, Shift, and Control are special and hard-coded */
 }
 
-KeyCode* obt_keyboard_keysym_to_keycode(KeySym sym)
+/*! Returns the KeySym in a column of the keymap for a keycode.  This is the
+  same as Xlib's XKeycodeToKeysym, which fills in the shifted column from
+  the unshifted one for keys that only list one case. */
+static KeySym keycode_keysym(gint keycode, gint col)
+{
+    const KeySym *syms;
+    KeySym lsym, usym;
+    gint per = keysyms_per_keycode;
+
+    syms = &keymap[(keycode - min_keycode) * keysyms_per_keycode];
+    if (col < 4) {
+        if (col > 1) {
+            while (per > 2 && syms[per - 1] == NoSymbol) --per;
+            if (per < 3) col -= 2;
+        }
+        if (per <= (col|1) || syms[col|1] == NoSymbol) {
+            XConvertCase(syms[col&~1], &lsym, &usym);
+            if (!(col & 1))
+                return lsym;
+            else if (usym == lsym)
+                return NoSymbol;
+            else
+                return usym;
+        }
+    }
+    return syms[col];
+}
+
+static void keysym_codes_free(GArray *codes)
+{
+    g_array_free(codes, TRUE);
+}
+
+static void keysym_codes_build(void)
 {
-    KeyCode *ret;
-    gint i, j, n;
-
-    ret = g_new(KeyCode, 1);
-    n = 0;
-    ret[n] = 0;
-
-    /* go through each keycode and look for the keysym */
-    for (i = min_keycode; i <= max_keycode; ++i)
-        for (j = 0; j < keysyms_per_keycode; ++j)
-            if (sym == keymap[(i-min_keycode) * keysyms_per_keycode + j]) {
-                ret = g_renew(KeyCode, ret, ++n + 1);
-                ret[n-1] = i;
-                ret[n] = 0;
+    gint i, j;
+
+    keysym_codes = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                         (GDestroyNotify)keysym_codes_free);
+    if (!keymap) return;
+
+    /* like XKeysymToKeycode, the keycodes which have the keysym in an
+       earlier column come first */
+    for (j = 0; j < keysyms_per_keycode; ++j)
+        for (i = min_keycode; i <= max_keycode; ++i) {
+            KeySym sym = keycode_keysym(i, j);
+            KeyCode code = i;
+            GArray *codes;
+
+            if (sym == NoSymbol) continue;
+
+            codes = g_hash_table_lookup(keysym_codes, GUINT_TO_POINTER(sym));
+            if (!codes) {
+                codes = g_array_new(TRUE, FALSE, sizeof(KeyCode));
+                g_hash_table_insert(keysym_codes, GUINT_TO_POINTER(sym),
+                                    codes);
             }
-    return ret;
+            g_array_append_val(codes, code);
+        }
+}
+
+KeyCode* obt_keyboard_keysym_to_keycode(KeySym sym)
+{
+    GArray *codes;
+
+    codes = keysym_codes ?
+        g_hash_table_lookup(keysym_codes, GUINT_TO_POINTER(sym)) : NULL;
+    if (!codes)
+        return g_new0(KeyCode, 1);
+    return g_memdup(codes->data, (codes->len + 1) * sizeof(KeyCode));
 }
 
 gunichar obt_keyboard_keypress_to_unichar(ObtIC *ic, XEvent *ev)
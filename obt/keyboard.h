@@ -59,7 +59,9 @@ guint obt_keyboard_only_modmasks(guint mask);
   right keys when there are both. */
 guint obt_keyboard_modkey_to_modmask(ObtModkeysKey key);
 
-/*! Convert a KeySym to all the KeyCodes which generate it. */
+/*! Convert a KeySym to all the KeyCodes which generate it.  The list ends
+  with a 0, and the first KeyCode is the one XKeysymToKeycode would give.  It
+  needs to be freed with g_free. */
 KeyCode* obt_keyboard_keysym_to_keycode(KeySym sym);
 
 /*! Translate a KeyPress event to the unicode character it represents */
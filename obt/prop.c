@@ -223,6 +223,7 @@ static gboolean get_prealloc(Window win, Atom prop, Atom type, gint size,
     res = XGetWindowProperty(obt_display, win, prop, 0l, num32,
                              FALSE, type, &ret_type, &ret_size,
                              &ret_items, &bytes_left, &xdata);
+    obt_display_round_trip();
     if (res == Success && ret_items && xdata) {
         if (ret_size == size && ret_items >= num) {
             guint i;
@@ -260,25 +261,29 @@ static gboolean get_all(Window win, Atom prop, Atom type, gint size,
     res = XGetWindowProperty(obt_display, win, prop, 0l, G_MAXLONG,
                              FALSE, type, &ret_type, &ret_size,
                              &ret_items, &bytes_left, &xdata);
+    obt_display_round_trip();
     if (res == Success) {
         if (ret_size == size && ret_items > 0) {
-            guint i;
+            gulong i;
 
             *data = g_malloc(ret_items * (size / 8));
-            for (i = 0; i < ret_items; ++i)
-                switch (size) {
-                case 8:
-                    (*data)[i] = xdata[i];
-                    break;
-                case 16:
+            /* each loop is kept simple so that the compiler can vectorize
+               it, as these can be large, like _NET_WM_ICON */
+            switch (size) {
+            case 8:
+                memcpy(*data, xdata, ret_items);
+                break;
+            case 16:
+                for (i = 0; i < ret_items; ++i)
                     ((guint16*)*data)[i] = ((gushort*)xdata)[i];
-                    break;
-                case 32:
+                break;
+            case 32:
+                for (i = 0; i < ret_items; ++i)
                     ((guint32*)*data)[i] = ((gulong*)xdata)[i];
-                    break;
-                default:
-                    g_assert_not_reached(); /* unhandled size */
-                }
+                break;
+            default:
+                g_assert_not_reached(); /* unhandled size */
+            }
             *num = ret_items;
             ret = TRUE;
         }
@@ -299,6 +304,7 @@ static gboolean get_all(Window win, Atom prop, Atom type, gint size,
 static gboolean get_text_property(Window win, Atom prop,
                                   XTextProperty *tprop, ObtPropTextType type)
 {
+    obt_display_round_trip();
     if (!(XGetTextProperty(obt_display, win, tprop, prop) && tprop->nitems))
         return FALSE;
     if (!type)
@@ -481,6 +487,22 @@ gboolean obt_prop_get_array32(Window win, Atom prop, Atom type, guint32 **ret,
     return get_all(win, prop, type, 32, (guchar**)ret, nret);
 }
 
+gulong obt_prop_size(Window win, Atom prop)
+{
+    Atom ret_type;
+    gint ret_size;
+    gulong ret_items, bytes_left = 0;
+    guchar *xdata = NULL;
+
+    if (XGetWindowProperty(obt_display, win, prop, 0l, 0l, FALSE,
+                           AnyPropertyType, &ret_type, &ret_size,
+                           &ret_items, &bytes_left, &xdata) != Success)
+        bytes_left = 0;
+    obt_display_round_trip();
+    if (xdata) XFree(xdata);
+    return bytes_left;
+}
+
 gboolean obt_prop_get_text(Window win, Atom prop, ObtPropTextType type,
                            gchar **ret_string)
 {
@@ -249,6 +249,9 @@ typedef enum {
 gboolean obt_prop_get32(Window win, Atom prop, Atom type, guint32 *ret);
 gboolean obt_prop_get_array32(Window win, Atom prop, Atom type, guint32 **ret,
                               guint *nret);
+/*! Returns the size of a property in bytes as it is sent by the X server,
+  without transferring any of it, or 0 if it is not set */
+gulong obt_prop_size(Window win, Atom prop);
 
 gboolean obt_prop_get_text(Window win, Atom prop, ObtPropTextType type,
                            gchar **ret);
@@ -278,6 +281,7 @@ void obt_prop_message_to(Window to, Window about, Atom messagetype,
 #define OBT_PROP_GETA32(win, prop, type, ret, nret) \
     (obt_prop_get_array32(win, OBT_PROP_ATOM(prop), OBT_PROP_ATOM(type), \
                           ret, nret))
+#define OBT_PROP_SIZE(win, prop) (obt_prop_size(win, OBT_PROP_ATOM(prop)))
 #define OBT_PROP_GETS(win, prop, ret) \
     (obt_prop_get_text(win, OBT_PROP_ATOM(prop), 0, ret))
 #define OBT_PROP_GETSS(win, prop, ret) \
@@ -53,6 +53,21 @@ struct _ObtXmlInst {
     gchar *last_error_message;
 };
 
+/*! A file being parsed on another thread */
+struct Preload {
+    gchar *path;
+    GThread *thread;
+    xmlDocPtr doc;
+    /* libxml keeps the last error for each thread, so keep it here to give to
+       the instance that loads the file */
+    gchar *error_file;
+    gint error_line;
+    gchar *error_message;
+};
+
+/* the files being preloaded, keyed by their paths */
+static GHashTable *preloads = NULL;
+
 static void obt_xml_save_last_error(ObtXmlInst* inst);
 
 static void destfunc(struct Callback *c)
@@ -127,6 +142,132 @@ void obt_xml_unregister(ObtXmlInst *i, const gchar *tag)
     g_hash_table_remove(i->callbacks, tag);
 }
 
+static xmlDocPtr read_file(const gchar *path)
+{
+    xmlDocPtr doc;
+
+    /* XML_PARSE_BLANKS is needed apparently, or the tree can end up
+       with extra nodes in it. */
+    doc = xmlReadFile(path, NULL, (XML_PARSE_NOBLANKS |
+                                   XML_PARSE_RECOVER));
+    xmlXIncludeProcessFlags(doc, (XML_PARSE_NOBLANKS |
+                                  XML_PARSE_RECOVER));
+    return doc;
+}
+
+static gpointer preload_func(gpointer data)
+{
+    struct Preload *p = data;
+    xmlErrorPtr error;
+
+    xmlResetLastError();
+    p->doc = read_file(p->path);
+    if ((error = xmlGetLastError())) {
+        p->error_file = g_strdup(error->file);
+        p->error_line = error->line;
+        p->error_message = g_strdup(error->message);
+        xmlResetError(error);
+    }
+    return NULL;
+}
+
+static void preload_free(struct Preload *p)
+{
+    g_free(p->path);
+    g_free(p->error_file);
+    g_free(p->error_message);
+    g_slice_free(struct Preload, p);
+}
+
+void obt_xml_preload_file(const gchar *path)
+{
+    struct Preload *p;
+    struct stat s;
+
+    if (!preloads) {
+        /* this has to happen before libxml is used from other threads */
+        xmlInitParser();
+        preloads = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+
+    if (g_hash_table_lookup(preloads, path) || stat(path, &s) < 0)
+        return;
+
+    p = g_slice_new0(struct Preload);
+    p->path = g_strdup(path);
+    p->error_line = -1;
+    p->thread = g_thread_try_new("obt-xml", preload_func, p, NULL);
+    if (!p->thread) {
+        /* it will just be parsed when it is loaded */
+        preload_free(p);
+        return;
+    }
+    g_hash_table_insert(preloads, p->path, p);
+}
+
+gboolean obt_xml_preload_config_file(const gchar *domain,
+                                     const gchar *filename)
+{
+    ObtPaths *paths;
+    GSList *it;
+    gboolean r = FALSE;
+
+    paths = obt_paths_new();
+    /* find the same file that load_file will */
+    for (it = obt_paths_config_dirs(paths); !r && it; it = g_slist_next(it)) {
+        gchar *path;
+        struct stat s;
+
+        path = g_build_filename(it->data, domain, filename, NULL);
+        if (stat(path, &s) >= 0) {
+            obt_xml_preload_file(path);
+            r = TRUE;
+        }
+        g_free(path);
+    }
+    obt_paths_unref(paths);
+    return r;
+}
+
+/*! Use the preloaded document for the path, if there is one */
+static gboolean take_preload(ObtXmlInst *i, const gchar *path)
+{
+    struct Preload *p;
+
+    if (!preloads || !(p = g_hash_table_lookup(preloads, path)))
+        return FALSE;
+
+    g_hash_table_remove(preloads, path);
+    g_thread_join(p->thread);
+    i->doc = p->doc;
+    if (p->error_message) {
+        g_free(i->last_error_file);
+        g_free(i->last_error_message);
+        i->last_error_file = p->error_file;
+        i->last_error_line = p->error_line;
+        i->last_error_message = p->error_message;
+        p->error_file = p->error_message = NULL;
+    }
+    preload_free(p);
+    return TRUE;
+}
+
+void obt_xml_preload_clear(void)
+{
+    GHashTableIter it;
+    struct Preload *p;
+
+    if (!preloads) return;
+
+    g_hash_table_iter_init(&it, preloads);
+    while (g_hash_table_iter_next(&it, NULL, (gpointer*)&p)) {
+        g_thread_join(p->thread);
+        if (p->doc) xmlFreeDoc(p->doc);
+        preload_free(p);
+        g_hash_table_iter_remove(&it);
+    }
+}
+
 static gboolean load_file(ObtXmlInst *i,
                           const gchar *domain,
                           const gchar *filename,
@@ -150,12 +291,8 @@ static gboolean load_file(ObtXmlInst *i,
             path = g_build_filename(it->data, domain, filename, NULL);
 
         if (stat(path, &s) >= 0) {
-            /* XML_PARSE_BLANKS is needed apparently, or the tree can end up
-               with extra nodes in it. */
-            i->doc = xmlReadFile(path, NULL, (XML_PARSE_NOBLANKS |
-                                              XML_PARSE_RECOVER));
-            xmlXIncludeProcessFlags(i->doc, (XML_PARSE_NOBLANKS |
-                                             XML_PARSE_RECOVER));
+            if (!take_preload(i, path))
+                i->doc = read_file(path);
             if (i->doc) {
                 i->root = xmlDocGetRootElement(i->doc);
                 if (!i->root) {
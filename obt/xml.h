@@ -51,6 +51,16 @@ gboolean obt_xml_load_theme_file(ObtXmlInst *inst,
 gboolean obt_xml_load_mem(ObtXmlInst *inst,
                           gpointer data, guint len, const gchar *root_node);
 
+/*! Start parsing a file on another thread, so that loading it later only has
+  to wait for the parsing to finish */
+void obt_xml_preload_file(const gchar *path);
+/*! Start parsing the file obt_xml_load_config_file would load, returns FALSE
+  if there is no such file */
+gboolean obt_xml_preload_config_file(const gchar *domain,
+                                     const gchar *filename);
+/*! Wait for and throw away any preloaded files which weren't loaded */
+void obt_xml_preload_clear(void);
+
 /* Returns true if an error is present. */
 gboolean obt_xml_last_error(ObtXmlInst *inst);
 gchar* obt_xml_last_error_file(ObtXmlInst *inst);
@@ -319,6 +319,12 @@ gboolean xqueue_pending_local(void)
     return qnum != 0;
 }
 
+gulong xqueue_length(void)
+{
+    /* count the ones Xlib has read but not handed over to us yet too */
+    return qnum + XQLength(obt_display);
+}
+
 typedef struct _ObtXQueueCB {
     ObtXQueueFunc func;
     gpointer data;
@@ -62,6 +62,10 @@ gboolean xqueue_next_local(XEvent *event_return);
   otherwise. */
 gboolean xqueue_pending_local(void);
 
+/*! Returns the number of events that have been read from the server and not
+  processed yet, without reading any more */
+gulong xqueue_length(void);
+
 /*! Returns TRUE and passes the next event in the queue, or FALSE if there
   is an error */
 gboolean xqueue_peek(XEvent *event_return);
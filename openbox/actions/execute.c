@@ -1,6 +1,7 @@
 #include "openbox/actions.h"
 #include "openbox/event.h"
 #include "openbox/startupnotify.h"
+#include "openbox/launcher.h"
 #include "openbox/client.h"
 #include "openbox/prompt.h"
 #include "openbox/screen.h"
@@ -286,10 +287,7 @@ static gboolean run_func(ObActionsData *data, gpointer options)
         }
 
         e = NULL;
-        ok = g_spawn_async(NULL, argv, NULL,
-                           G_SPAWN_SEARCH_PATH |
-                           G_SPAWN_DO_NOT_REAP_CHILD,
-                           NULL, NULL, NULL, &e);
+        ok = launcher_spawn(argv, &e);
         if (!ok) {
             g_message("%s", e->message);
             g_error_free(e);
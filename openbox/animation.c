@@ -0,0 +1,246 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   animation.c for the Openbox window manager
+   Copyright (c) 2003-2008   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "animation.h"
+#include "openbox.h"
+#include "debug.h"
+#include "obt/display.h"
+
+/*! Used when the refresh rate of the display can't be found (60 Hz) */
+#define ANIMATION_DEFAULT_FRAME_TIME (G_USEC_PER_SEC / 60)
+
+typedef struct _ObAnimation
+{
+    guint id;
+    gint64 start;    /*!< When the animation started */
+    gulong duration; /*!< How long it lasts, 0 for no end */
+    gulong interval; /*!< The minimum time between steps */
+    gint64 next;     /*!< When the next step is due */
+    ObAnimationEase ease;
+    ObAnimationFunc func;
+    gpointer data;
+    GDestroyNotify notify;
+} ObAnimation;
+
+static GSList *animations      = NULL;
+static guint   animation_id    = 1;
+static guint   animation_timer = 0;
+static gulong  animation_frame = ANIMATION_DEFAULT_FRAME_TIME;
+
+static void animation_schedule(void);
+
+static void find_frame_time(void)
+{
+    animation_frame = ANIMATION_DEFAULT_FRAME_TIME;
+
+#ifdef XRANDR
+    if (obt_display_extension_randr) {
+        XRRScreenConfiguration *sc;
+
+        sc = XRRGetScreenInfo(obt_display, obt_root(ob_screen));
+        if (sc) {
+            const gshort rate = XRRConfigCurrentRate(sc);
+            if (rate > 0)
+                animation_frame = G_USEC_PER_SEC / rate;
+            XRRFreeScreenConfigInfo(sc);
+        }
+    }
+#endif
+
+    ob_debug("Animating at %lu microseconds per frame", animation_frame);
+}
+
+void animation_startup(gboolean reconfig)
+{
+    /* the refresh rate may have changed along with the screen configuration,
+       so look it up again on reconfigure too */
+    find_frame_time();
+}
+
+void animation_shutdown(gboolean reconfig)
+{
+    if (reconfig) return;
+
+    while (animations)
+        animation_remove(((ObAnimation*)animations->data)->id);
+}
+
+static ObAnimation* find_animation(guint id)
+{
+    GSList *it;
+
+    for (it = animations; it; it = g_slist_next(it))
+        if (((ObAnimation*)it->data)->id == id)
+            return it->data;
+    return NULL;
+}
+
+static gdouble ease(ObAnimationEase e, gdouble t)
+{
+    switch (e) {
+    case OB_ANIMATION_EASE_LINEAR:
+        return t;
+    case OB_ANIMATION_EASE_IN:
+        return t * t;
+    case OB_ANIMATION_EASE_OUT:
+        return t * (2.0 - t);
+    case OB_ANIMATION_EASE_IN_OUT:
+        return t < 0.5 ? 2.0 * t * t : -1.0 + (4.0 - 2.0 * t) * t;
+    }
+    g_assert_not_reached();
+    return t;
+}
+
+static gdouble progress_at(ObAnimation *a, gint64 now)
+{
+    gdouble p;
+
+    if (a->duration == 0) return 0.0;
+
+    p = (gdouble)(now - a->start) / a->duration;
+    return CLAMP(p, 0.0, 1.0);
+}
+
+static gboolean animation_tick(gpointer data)
+{
+    GSList *due, *it;
+    gint64 now;
+
+    animation_timer = 0;
+    now = g_get_monotonic_time();
+
+    /* find everything which is due now, or within half a frame, so that
+       animations which are almost in step get advanced together */
+    due = NULL;
+    for (it = animations; it; it = g_slist_next(it)) {
+        ObAnimation *a = it->data;
+        if (a->next <= now + (gint64)animation_frame / 2)
+            due = g_slist_prepend(due, GUINT_TO_POINTER(a->id));
+    }
+    due = g_slist_reverse(due);
+
+    /* the functions can add or remove animations, so look them up by id */
+    for (it = due; it; it = g_slist_next(it)) {
+        ObAnimation *a = find_animation(GPOINTER_TO_UINT(it->data));
+        gdouble p;
+
+        if (!a) continue;
+
+        p = progress_at(a, now);
+        if (!a->func(ease(a->ease, p), a->data) ||
+            (a->duration && p >= 1.0))
+        {
+            animation_remove(a->id);
+        }
+        else
+            a->next = now + MAX(a->interval, animation_frame);
+    }
+
+    /* one flush for everything that was done in this frame */
+    if (due) XFlush(obt_display);
+    g_slist_free(due);
+
+    animation_schedule();
+    return FALSE; /* animation_schedule() sets up the next one */
+}
+
+static void animation_schedule(void)
+{
+    GSList *it;
+    gint64 next, now;
+    guint ms;
+
+    if (animation_timer) {
+        g_source_remove(animation_timer);
+        animation_timer = 0;
+    }
+    if (!animations) return;
+
+    next = G_MAXINT64;
+    for (it = animations; it; it = g_slist_next(it))
+        next = MIN(next, ((ObAnimation*)it->data)->next);
+
+    now = g_get_monotonic_time();
+    /* round up so we don't wake up early and find nothing to do */
+    ms = next > now ? (next - now + 999) / 1000 : 0;
+    animation_timer = g_timeout_add_full(G_PRIORITY_DEFAULT, ms,
+                                         animation_tick, NULL, NULL);
+}
+
+guint animation_add(gulong duration, gulong interval, ObAnimationEase ease,
+                    ObAnimationFunc func, gpointer data,
+                    GDestroyNotify notify)
+{
+    ObAnimation *a;
+
+    g_assert(func != NULL);
+
+    a = g_slice_new(ObAnimation);
+    a->id = animation_id++;
+    if (animation_id == 0) animation_id = 1; /* 0 is never valid */
+    a->start = g_get_monotonic_time();
+    a->duration = duration;
+    a->interval = interval;
+    a->next = a->start + MAX(interval, animation_frame);
+    a->ease = ease;
+    a->func = func;
+    a->data = data;
+    a->notify = notify;
+
+    animations = g_slist_append(animations, a);
+    animation_schedule();
+
+    return a->id;
+}
+
+gboolean animation_remove(guint id)
+{
+    ObAnimation *a;
+
+    if (!(a = find_animation(id))) return FALSE;
+
+    /* take it out before calling notify, so that notify can't find it */
+    animations = g_slist_remove(animations, a);
+    if (a->notify) a->notify(a->data);
+    g_slice_free(ObAnimation, a);
+
+    if (!animations) animation_schedule();
+    return TRUE;
+}
+
+gdouble animation_get_progress(guint id)
+{
+    ObAnimation *a;
+
+    if (!(a = find_animation(id))) return 0.0;
+    return progress_at(a, g_get_monotonic_time());
+}
+
+void animation_set_progress(guint id, gdouble progress)
+{
+    ObAnimation *a;
+
+    if (!(a = find_animation(id))) return;
+    a->start = g_get_monotonic_time() -
+        (gint64)(CLAMP(progress, 0.0, 1.0) * a->duration);
+}
+
+gulong animation_frame_time(void)
+{
+    return animation_frame;
+}
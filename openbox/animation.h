@@ -0,0 +1,75 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   animation.h for the Openbox window manager
+   Copyright (c) 2003-2008   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __animation_h
+#define __animation_h
+
+#include <glib.h>
+
+/*! The shape of the curve used to turn the time spent in an animation into
+  its progress */
+typedef enum {
+    OB_ANIMATION_EASE_LINEAR,
+    OB_ANIMATION_EASE_IN,
+    OB_ANIMATION_EASE_OUT,
+    OB_ANIMATION_EASE_IN_OUT
+} ObAnimationEase;
+
+/*! Advances an animation by one step.
+  @param progress How far through the animation it is, between 0.0 and 1.0,
+                  after the easing curve is applied. Always 0.0 for an
+                  animation without a duration.
+  @return FALSE to stop the animation early, TRUE to keep it going
+*/
+typedef gboolean (*ObAnimationFunc)(gdouble progress, gpointer data);
+
+void animation_startup(gboolean reconfig);
+void animation_shutdown(gboolean reconfig);
+
+/*! Adds an animation which is stepped by the shared animation clock. All the
+  animations which are due are stepped together, and the X display is flushed
+  once after each step.
+  @param duration The length of the animation in microseconds. If 0, the
+                  animation runs until its func returns FALSE.
+  @param interval The minimum time in microseconds between steps. If 0, the
+                  animation is stepped on every frame of the display.
+  @param func Called for each step of the animation.
+  @param data Passed to func and notify.
+  @param notify Called when the animation ends or is removed. May be NULL.
+  @return An id for the animation, which is never 0.
+*/
+guint animation_add(gulong duration, gulong interval, ObAnimationEase ease,
+                    ObAnimationFunc func, gpointer data,
+                    GDestroyNotify notify);
+
+/*! Removes an animation, calling its notify function.
+  @return TRUE if the animation was found and removed.
+*/
+gboolean animation_remove(guint id);
+
+/*! Returns how far through its duration an animation is, before easing, or
+  0.0 if it does not exist */
+gdouble animation_get_progress(guint id);
+
+/*! Moves an animation to a point in its duration, before easing */
+void animation_set_progress(guint id, gdouble progress);
+
+/*! Returns the time between frames of the display, in microseconds */
+gulong animation_frame_time(void);
+
+#endif
@@ -0,0 +1,38 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   checksum.h for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __ob__checksum_h
+#define __ob__checksum_h
+
+#include <glib.h>
+
+/*! A quick checksum (FNV-1a) of some data, for noticing when a file that was
+  saved has been damaged.  It is not made to detect changes on purpose. */
+static inline guint32 ob_checksum(const guchar *data, gsize len)
+{
+    guint32 h = 2166136261u;
+    gsize i;
+
+    for (i = 0; i < len; ++i) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+#endif
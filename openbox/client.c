@@ -27,6 +27,8 @@
 #include "place.h"
 #include "frame.h"
 #include "session.h"
+#include "restart.h"
+#include "metrics.h"
 #include "event.h"
 #include "grab.h"
 #include "prompt.h"
@@ -73,6 +75,9 @@ GList          *client_list             = NULL;
 
 static GSList  *client_destroy_notifies = NULL;
 static RrImage *client_default_icon     = NULL;
+static GSList  *client_wm_state_pending = NULL;
+static GSList  *client_net_state_pending = NULL;
+static guint    client_wm_state_defers  = 0;
 
 static void client_get_all(ObClient *self, gboolean real);
 static void client_get_startup_id(ObClient *self);
@@ -90,6 +95,8 @@ static void client_set_desktop_recursive(ObClient *self,
 static void client_change_allowed_actions(ObClient *self);
 static void client_change_state(ObClient *self);
 static void client_change_wm_state(ObClient *self);
+static void client_write_wm_state(ObClient *self);
+static void client_write_net_state(ObClient *self);
 static void client_apply_startup_state(ObClient *self,
                                        gint x, gint y, gint w, gint h);
 static void client_restore_session_state(ObClient *self);
@@ -285,6 +292,9 @@ void client_manage(Window window, ObPrompt *prompt)
        time now */
     grab_server(FALSE);
 
+    /* the icons can be big, so don't hold the server while reading them */
+    client_update_icons(self);
+
     /* this needs to occur once we have a frame, since it sets a property on
        the frame */
     client_update_opacity(self);
@@ -536,6 +546,8 @@ void client_manage(Window window, ObPrompt *prompt)
     /* free the ObAppSettings shallow copy */
     g_slice_free(ObAppSettings, settings);
 
+    metrics_inc(OB_METRIC_CLIENTS_MANAGED);
+
     ob_debug("Managed window 0x%lx plate 0x%x (%s)",
              window, self->frame->window, self->class);
 }
@@ -584,6 +596,10 @@ void client_unmanage(ObClient *self)
     GSList *it;
     gulong ignore_start;
 
+    metrics_inc(OB_METRIC_CLIENTS_UNMANAGED);
+
+    if (self->session) self->session->client = NULL;
+
     ob_debug("Unmanaging window: 0x%x plate 0x%x (%s) (%s)",
              self->window, self->frame->window,
              self->class, self->title ? self->title : "");
@@ -614,6 +630,10 @@ void client_unmanage(ObClient *self)
     if (!self->prompt)
         XChangeSaveSet(obt_display, self->window, SetModeDelete);
 
+    /* don't write a deferred state to a window we no longer own */
+    client_wm_state_pending = g_slist_remove(client_wm_state_pending, self);
+    client_net_state_pending = g_slist_remove(client_net_state_pending, self);
+
     /* update the focus lists */
     focus_order_remove(self);
     if (client_focused(self)) {
@@ -642,12 +662,14 @@ void client_unmanage(ObClient *self)
             g_slist_remove(((ObClient*)it->data)->transients,self);
 
     /* tell our transients that we're gone */
+    stacking_freeze();
     for (it = self->transients; it; it = g_slist_next(it)) {
         ((ObClient*)it->data)->parents =
             g_slist_remove(((ObClient*)it->data)->parents, self);
         /* we could be keeping our children in a higher layer */
         client_calc_layer(it->data);
     }
+    stacking_thaw();
 
     /* remove from its group */
     if (self->group) {
@@ -1014,6 +1036,7 @@ static void client_restore_session_state(ObClient *self)
     }
 
     self->session = it->data;
+    self->session->client = self;
 
     ob_debug_type(OB_DEBUG_SM, "Session data loaded for client %s",
                   self->title);
@@ -1056,16 +1079,13 @@ static gboolean client_restore_session_stacking(ObClient *self)
 
     /* start above me and look for the first client */
     for (it = g_list_previous(mypos); it; it = g_list_previous(it)) {
-        GList *cit;
-
-        for (cit = client_list; cit; cit = g_list_next(cit)) {
-            ObClient *c = cit->data;
-            /* found a client that was in the session, so go below it */
-            if (c->session == it->data) {
-                stacking_below(CLIENT_AS_WINDOW(self),
-                               CLIENT_AS_WINDOW(cit->data));
-                return TRUE;
-            }
+        ObSessionState *s = it->data;
+
+        /* found a client that was in the session, so go below it */
+        if (s->client) {
+            stacking_below(CLIENT_AS_WINDOW(self),
+                           CLIENT_AS_WINDOW(s->client));
+            return TRUE;
         }
     }
     return FALSE;
@@ -1261,7 +1281,7 @@ static void client_get_all(ObClient *self, gboolean real)
 
     client_get_colormap(self);
     client_update_strut(self);
-    client_update_icons(self);
+    /* the icons are read by client_manage once the server is released */
     client_update_icon_geometry(self);
 }
 
@@ -2083,8 +2103,9 @@ void client_update_wmhints(ObClient *self)
                 client_update_transient_for(self);
         }
 
-        /* the WM_HINTS can contain an icon */
-        if (hints->flags & IconPixmapHint)
+        /* the WM_HINTS can contain an icon (while being managed the icons
+           are read afterward) */
+        if ((hints->flags & IconPixmapHint) && self->frame)
             client_update_icons(self);
 
         XFree(hints);
@@ -2221,50 +2242,139 @@ void client_update_strut(ObClient *self)
     }
 }
 
+/*! The sizes that icons are drawn at: in the titlebar, in the focus cycling
+  popup and in the client list menus */
+#define NUM_ICON_SLOTS 3
+
+static void icon_slot_sizes(guint *sizes)
+{
+    sizes[0] = ob_rr_theme->button_size + 2;
+    sizes[1] = config_theme_window_list_icon_size;
+    sizes[2] = ob_rr_theme->menu_font_height;
+}
+
+/*! Picks which of the icons in a _NET_WM_ICON are worth keeping.  For each
+  size an icon is drawn at, the smallest icon which is at least that big is
+  kept, so it is only ever scaled down.  The largest icon is always kept too,
+  to scale from when the theme changes.
+  @param data The _NET_WM_ICON, which holds n icons
+  @param offs The offset of each icon's width in the data
+  @param keep Set to TRUE for each icon that should be kept
+*/
+static void icon_choose(const guint32 *data, const guint *offs, guint n,
+                        gboolean *keep)
+{
+    guint sizes[NUM_ICON_SLOTS];
+    guint i, j, largest;
+
+    icon_slot_sizes(sizes);
+
+    largest = 0;
+    for (i = 0; i < n; ++i) {
+        const guint32 *d = data + offs[i], *l = data + offs[largest];
+
+        keep[i] = FALSE;
+        if ((guint64)d[0] * d[1] > (guint64)l[0] * l[1])
+            largest = i;
+    }
+    keep[largest] = TRUE;
+
+    for (j = 0; j < NUM_ICON_SLOTS; ++j) {
+        gint best = -1;
+        guint bestsz = 0;
+
+        for (i = 0; i < n; ++i) {
+            const guint32 *d = data + offs[i];
+            const guint sz = MAX(d[0], d[1]);
+
+            if (sz >= sizes[j] && (best < 0 || sz < bestsz)) {
+                best = i;
+                bestsz = sz;
+            }
+        }
+        /* when none are big enough, the largest is the one to use */
+        if (best >= 0) keep[best] = TRUE;
+    }
+}
+
+static gboolean find_icon_change(XEvent *e, gpointer data)
+{
+    Window *w = data;
+    return (e->type == PropertyNotify && e->xproperty.window == *w &&
+            e->xproperty.atom == OBT_PROP_ATOM(NET_WM_ICON));
+}
+
 void client_update_icons(ObClient *self)
 {
     guint num;
     guint32 *data;
-    guint w, h, i, j;
+    guint w, h, i, n;
     RrImage *img;
 
     img = NULL;
 
-    /* grab the server, because we might be setting the window's icon and
-       we don't want them to set it in between and we overwrite their own
-       icon */
-    grab_server(TRUE);
+    /* reuse what was decoded before a restart, if it's still the same */
+    if (ob_state() == OB_STATE_STARTING)
+        img = restart_take_icons(self->window);
+
+    if (!img &&
+        OBT_PROP_GETA32(self->window, NET_WM_ICON, CARDINAL, &data, &num)) {
+        GArray *offs;
+        gboolean *keep;
 
-    if (OBT_PROP_GETA32(self->window, NET_WM_ICON, CARDINAL, &data, &num)) {
         /* figure out how many valid icons are in here */
+        offs = g_array_new(FALSE, FALSE, sizeof(guint));
         i = 0;
         while (i + 2 < num) { /* +2 is to make sure there is a w and h */
-            w = data[i++];
-            h = data[i++];
+            w = data[i];
+            h = data[i+1];
             /* watch for the data being too small for the specified size,
                or for zero sized icons. */
-            if (i + w*h > num || w == 0 || h == 0) {
-                i += w*h;
-                continue;
-            }
+            if (w > 0 && h > 0 && w*h <= num - i - 2)
+                g_array_append_val(offs, i);
+            else if (w > G_MAXUINT16 || h > G_MAXUINT16)
+                break; /* bogus, and w*h may have wrapped */
+            i += 2 + w*h;
+        }
 
-            /* convert it to the right bit order for ObRender */
-            for (j = 0; j < w*h; ++j)
-                data[i+j] =
-                    (((data[i+j] >> 24) & 0xff) << RrDefaultAlphaOffset) +
-                    (((data[i+j] >> 16) & 0xff) << RrDefaultRedOffset)   +
-                    (((data[i+j] >>  8) & 0xff) << RrDefaultGreenOffset) +
-                    (((data[i+j] >>  0) & 0xff) << RrDefaultBlueOffset);
+        /* only the ones that will be drawn are decoded and kept, as a
+           client can give many large icons */
+        keep = g_new(gboolean, MAX(offs->len, 1));
+        if (offs->len)
+            icon_choose(data, (guint*)offs->data, offs->len, keep);
+
+        for (n = 0; n < offs->len; ++n) {
+            guint32 *d;
+
+            if (!keep[n]) continue;
+
+            d = data + g_array_index(offs, guint, n);
+            w = d[0];
+            h = d[1];
+            d += 2;
+
+#if RrDefaultAlphaOffset != 24 || RrDefaultRedOffset != 16 || \
+    RrDefaultGreenOffset != 8 || RrDefaultBlueOffset != 0
+            /* convert it to the right bit order for ObRender.  when
+               ObRender uses the same order as _NET_WM_ICON, which it does
+               by default, there is nothing to do */
+            for (i = 0; i < w*h; ++i)
+                d[i] =
+                    (((d[i] >> 24) & 0xff) << RrDefaultAlphaOffset) +
+                    (((d[i] >> 16) & 0xff) << RrDefaultRedOffset)   +
+                    (((d[i] >>  8) & 0xff) << RrDefaultGreenOffset) +
+                    (((d[i] >>  0) & 0xff) << RrDefaultBlueOffset);
+#endif
 
             /* add it to the image cache as an original */
             if (!img)
-                img = RrImageNewFromData(ob_rr_icons, &data[i], w, h);
+                img = RrImageNewFromData(ob_rr_icons, d, w, h);
             else
-                RrImageAddFromData(img, &data[i], w, h);
-
-            i += w*h;
+                RrImageAddFromData(img, d, w, h);
         }
 
+        g_free(keep);
+        g_array_free(offs, TRUE);
         g_free(data);
     }
 
@@ -2307,27 +2417,37 @@ void client_update_icons(ObClient *self)
        but, if it has parents, then one of them will have an icon already
     */
     if (!self->icon_set && !self->parents) {
-        RrPixel32 *icon = ob_rr_theme->def_win_icon;
-        gulong *ldata; /* use a long here to satisfy OBT_PROP_SETA32 */
-
-        w = ob_rr_theme->def_win_icon_w;
-        h = ob_rr_theme->def_win_icon_h;
-        ldata = g_new(gulong, w*h+2);
-        ldata[0] = w;
-        ldata[1] = h;
-        for (i = 0; i < w*h; ++i)
-            ldata[i+2] = (((icon[i] >> RrDefaultAlphaOffset) & 0xff) << 24) +
-                (((icon[i] >> RrDefaultRedOffset) & 0xff) << 16) +
-                (((icon[i] >> RrDefaultGreenOffset) & 0xff) << 8) +
-                (((icon[i] >> RrDefaultBlueOffset) & 0xff) << 0);
-        OBT_PROP_SETA32(self->window, NET_WM_ICON, CARDINAL, ldata, w*h+2);
-        g_free(ldata);
+        /* grab the server, because we are setting the window's icon and we
+           don't want them to set it in between and we overwrite their own
+           icon.  the icons were read without the server grabbed, so if the
+           property has changed since then, leave it alone and read it again
+           when that PropertyNotify is handled */
+        grab_server(TRUE);
+        XSync(obt_display, FALSE); /* get all events on the server */
+        if (!xqueue_exists_local(find_icon_change, &self->window)) {
+            RrPixel32 *icon = ob_rr_theme->def_win_icon;
+            gulong *ldata; /* use a long here to satisfy OBT_PROP_SETA32 */
+
+            w = ob_rr_theme->def_win_icon_w;
+            h = ob_rr_theme->def_win_icon_h;
+            ldata = g_new(gulong, w*h+2);
+            ldata[0] = w;
+            ldata[1] = h;
+            for (i = 0; i < w*h; ++i)
+                ldata[i+2] =
+                    (((icon[i] >> RrDefaultAlphaOffset) & 0xff) << 24) +
+                    (((icon[i] >> RrDefaultRedOffset) & 0xff) << 16) +
+                    (((icon[i] >> RrDefaultGreenOffset) & 0xff) << 8) +
+                    (((icon[i] >> RrDefaultBlueOffset) & 0xff) << 0);
+            OBT_PROP_SETA32(self->window, NET_WM_ICON, CARDINAL, ldata,
+                            w*h+2);
+            g_free(ldata);
+        }
+        grab_server(FALSE);
     } else if (self->frame)
         /* don't draw the icon empty if we're just setting one now anyways,
            we'll get the property change any second */
         frame_adjust_icon(self->frame);
-
-    grab_server(FALSE);
 }
 
 void client_update_icon_geometry(ObClient *self)
@@ -2501,7 +2621,6 @@ static void client_save_app_rule_values(ObClient *self)
 
 static void client_change_wm_state(ObClient *self)
 {
-    gulong state[2];
     glong old;
 
     old = self->wmstate;
@@ -2514,16 +2633,72 @@ static void client_change_wm_state(ObClient *self)
         self->wmstate = NormalState;
 
     if (old != self->wmstate) {
-        OBT_PROP_MSG(ob_screen, self->window, KDE_WM_CHANGE_STATE,
-                     self->wmstate, 1, 0, 0, 0);
+        if (client_wm_state_defers) {
+            if (!g_slist_find(client_wm_state_pending, self))
+                client_wm_state_pending =
+                    g_slist_prepend(client_wm_state_pending, self);
+        }
+        else
+            client_write_wm_state(self);
+    }
+}
+
+static void client_write_wm_state(ObClient *self)
+{
+    gulong state[2];
+
+    OBT_PROP_MSG(ob_screen, self->window, KDE_WM_CHANGE_STATE,
+                 self->wmstate, 1, 0, 0, 0);
 
-        state[0] = self->wmstate;
-        state[1] = None;
-        OBT_PROP_SETA32(self->window, WM_STATE, WM_STATE, state, 2);
+    state[0] = self->wmstate;
+    state[1] = None;
+    OBT_PROP_SETA32(self->window, WM_STATE, WM_STATE, state, 2);
+}
+
+void client_defer_wm_state(gboolean defer)
+{
+    if (defer)
+        ++client_wm_state_defers;
+    else {
+        g_assert(client_wm_state_defers > 0);
+        if (--client_wm_state_defers == 0) {
+            GSList *it;
+
+            /* the list was built by prepending, write them in the order
+               they changed */
+            client_wm_state_pending = g_slist_reverse(client_wm_state_pending);
+            for (it = client_wm_state_pending; it; it = g_slist_next(it))
+                client_write_wm_state(it->data);
+            g_slist_free(client_wm_state_pending);
+            client_wm_state_pending = NULL;
+
+            client_net_state_pending =
+                g_slist_reverse(client_net_state_pending);
+            for (it = client_net_state_pending; it; it = g_slist_next(it))
+                client_write_net_state(it->data);
+            g_slist_free(client_net_state_pending);
+            client_net_state_pending = NULL;
+        }
     }
 }
 
 static void client_change_state(ObClient *self)
+{
+    if (client_wm_state_defers) {
+        /* it is written from the client's state when the deferral ends, so
+           later changes are picked up too */
+        if (!g_slist_find(client_net_state_pending, self))
+            client_net_state_pending =
+                g_slist_prepend(client_net_state_pending, self);
+    }
+    else
+        client_write_net_state(self);
+
+    if (self->frame)
+        frame_adjust_state(self->frame);
+}
+
+static void client_write_net_state(ObClient *self)
 {
     gulong netstate[12];
     guint num;
@@ -2554,9 +2729,6 @@ static void client_change_state(ObClient *self)
     if (self->undecorated)
         netstate[num++] = OBT_PROP_ATOM(OB_WM_STATE_UNDECORATED);
     OBT_PROP_SETA32(self->window, NET_WM_STATE, ATOM, netstate, num);
-
-    if (self->frame)
-        frame_adjust_state(self->frame);
 }
 
 ObClient *client_search_focus_tree(ObClient *self)
@@ -2665,69 +2837,73 @@ static ObStackingLayer calc_layer(ObClient *self)
     return l;
 }
 
-static void client_calc_layer_recursive(ObClient *self, ObClient *orig,
-                                        ObStackingLayer min)
+/*! Marks the clients visited by the current layer calculation */
+static guint layer_visit = 0;
+
+/*! Recalculates the client's layer, and its transients' layers if it
+  changed.  A transient's layer only depends on its own state and the layers
+  of its parents, so the transients of a client which keeps its layer are
+  left alone. */
+static void client_calc_layer_down(ObClient *self)
 {
-    ObStackingLayer old, own;
+    ObStackingLayer l;
     GSList *it;
 
-    old = self->layer;
-    own = calc_layer(self);
-    self->layer = MAX(own, min);
+    self->visited = layer_visit;
 
-    if (self->layer != old) {
-        stacking_remove(CLIENT_AS_WINDOW(self));
-        stacking_add_nonintrusive(CLIENT_AS_WINDOW(self));
-    }
+    /* transients take on the layer of their parents */
+    l = calc_layer(self);
+    for (it = self->parents; it; it = g_slist_next(it))
+        l = MAX(l, ((ObClient*)it->data)->layer);
 
-    /* we've been restacked */
-    self->visited = TRUE;
+    if (l == self->layer) return;
+
+    self->layer = l;
+    stacking_remove(CLIENT_AS_WINDOW(self));
+    stacking_add_nonintrusive(CLIENT_AS_WINDOW(self));
 
     for (it = self->transients; it; it = g_slist_next(it))
-        client_calc_layer_recursive(it->data, orig,
-                                    self->layer);
+        client_calc_layer_down(it->data);
 }
 
-static void client_calc_layer_internal(ObClient *self)
+/*! Recalculates the client's parents before the client, since a parent
+  can change layer when focus moves inside its transient tree */
+static void client_calc_layer_up(ObClient *self)
 {
-    GSList *sit;
+    GSList *it;
 
-    /* transients take on the layer of their parents */
-    sit = client_search_all_top_parents(self);
+    if (self->visited == layer_visit) return;
 
-    for (; sit; sit = g_slist_next(sit))
-        client_calc_layer_recursive(sit->data, self, 0);
+    for (it = self->parents; it; it = g_slist_next(it))
+        client_calc_layer_up(it->data);
+    client_calc_layer_down(self);
 }
 
 void client_calc_layer(ObClient *self)
 {
     GList *it;
+    GSList *full = NULL, *sit;
 
-    /* skip over stuff above fullscreen layer */
-    for (it = stacking_list; it; it = g_list_next(it))
-        if (window_layer(it->data) <= OB_STACKING_LAYER_FULLSCREEN) break;
+    ++layer_visit;
 
-    /* find the windows in the fullscreen layer, and mark them not-visited */
-    for (; it; it = g_list_next(it)) {
-        if (window_layer(it->data) < OB_STACKING_LAYER_FULLSCREEN) break;
-        else if (WINDOW_IS_CLIENT(it->data))
-            WINDOW_AS_CLIENT(it->data)->visited = FALSE;
-    }
+    /* whether a window can stay fullscreen depends on what is focused, so
+       the windows in the fullscreen layer are checked too.  find them before
+       anything moves */
+    for (it = stacking_list; it; it = g_list_next(it)) {
+        ObStackingLayer l = window_layer(it->data);
 
-    client_calc_layer_internal(self);
+        if (l < OB_STACKING_LAYER_FULLSCREEN) break;
+        if (l == OB_STACKING_LAYER_FULLSCREEN && WINDOW_IS_CLIENT(it->data))
+            full = g_slist_prepend(full, it->data);
+    }
 
-    /* skip over stuff above fullscreen layer */
-    for (it = stacking_list; it; it = g_list_next(it))
-        if (window_layer(it->data) <= OB_STACKING_LAYER_FULLSCREEN) break;
+    stacking_freeze();
+    client_calc_layer_up(self);
+    for (sit = full; sit; sit = g_slist_next(sit))
+        client_calc_layer_up(sit->data);
+    stacking_thaw();
 
-    /* now recalc any windows in the fullscreen layer which have not
-       had their layer recalced already */
-    for (; it; it = g_list_next(it)) {
-        if (window_layer(it->data) < OB_STACKING_LAYER_FULLSCREEN) break;
-        else if (WINDOW_IS_CLIENT(it->data) &&
-                 !WINDOW_AS_CLIENT(it->data)->visited)
-            client_calc_layer_internal(it->data);
-    }
+    g_slist_free(full);
 }
 
 gboolean client_should_show(ObClient *self)
@@ -2797,6 +2973,57 @@ gboolean client_hide(ObClient *self)
     return hide;
 }
 
+void client_show_batch(GSList *clients)
+{
+    GSList *it, *frames = NULL;
+
+    /* replay pending pointer event once before showing anything, in case it
+       should be going to something under the windows */
+    mouse_replay_pointer();
+
+    for (it = clients; it; it = g_slist_next(it)) {
+        ObClient *c = it->data;
+        if (client_should_show(c))
+            frames = g_slist_prepend(frames, c->frame);
+    }
+    frames = g_slist_reverse(frames);
+    frame_show_batch(frames);
+    g_slist_free(frames);
+
+    /* see client_show() about the ICCCM */
+    for (it = clients; it; it = g_slist_next(it)) {
+        ObClient *c = it->data;
+        if (client_should_show(c))
+            client_change_wm_state(c);
+    }
+}
+
+GSList* client_hide_batch(GSList *clients)
+{
+    GSList *it, *hidden = NULL, *frames = NULL;
+
+    /* replay pending pointer event once before hiding anything, in case it
+       should be going to one of the windows */
+    mouse_replay_pointer();
+
+    for (it = clients; it; it = g_slist_next(it)) {
+        ObClient *c = it->data;
+        if (!client_should_show(c)) {
+            hidden = g_slist_prepend(hidden, c);
+            frames = g_slist_prepend(frames, c->frame);
+        }
+    }
+    hidden = g_slist_reverse(hidden);
+    frames = g_slist_reverse(frames);
+    frame_hide_batch(frames);
+    g_slist_free(frames);
+
+    /* see client_show() about the ICCCM */
+    for (it = hidden; it; it = g_slist_next(it))
+        client_change_wm_state(it->data);
+    return hidden;
+}
+
 void client_showhide(ObClient *self)
 {
     if (!client_show(self))
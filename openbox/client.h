@@ -314,8 +314,9 @@ struct _ObClient
     /*! Where the window should iconify to/from */
     Rect icon_geometry;
 
-    /*! A boolean used for algorithms which need to mark clients as visited */
-    gboolean visited;
+    /*! Used by algorithms which need to mark clients as visited.  Each search
+      uses a new number, so the marks never need to be cleared */
+    guint visited;
 };
 
 extern GList      *client_list;
@@ -568,6 +569,23 @@ gboolean client_hide(ObClient *self);
 */
 void client_showhide(ObClient *self);
 
+/*! Show all the clients in the list which should be shown. The windows are
+  mapped in the order of the list, all within one server grab.
+*/
+void client_show_batch(GSList *clients);
+
+/*! Hide all the clients in the list which should be hidden. The windows are
+  unmapped in the order of the list.
+  @return A list of the clients which were hidden, which must be freed.
+*/
+GSList* client_hide_batch(GSList *clients);
+
+/*! While deferred, changes to the WM_STATE and _NET_WM_STATE of clients are
+  remembered but not written to the windows. When the last deferral is
+  released, all the changed properties are written at once.
+*/
+void client_defer_wm_state(gboolean defer);
+
 /*! Validate client, by making sure no Destroy or Unmap events exist in
   the event queue for the window.
   @return true if the client is valid; false if the client has already
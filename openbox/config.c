@@ -52,6 +52,7 @@ guint    config_theme_window_list_icon_size;
 gchar   *config_title_layout;
 
 gboolean config_animate_iconify;
+gboolean config_theme_single_window;
 
 RrFont *config_font_activewindow;
 RrFont *config_font_inactivewindow;
@@ -106,6 +107,8 @@ gint     config_resist_edge;
 
 GSList *config_per_app_settings;
 
+gboolean config_control_socket;
+
 ObAppSettings* config_create_app_settings(void)
 {
     ObAppSettings *settings = g_slice_new0(ObAppSettings);
@@ -712,6 +715,8 @@ static void parse_theme(xmlNodePtr node, gpointer d)
         config_theme_keepborder = obt_xml_node_bool(n);
     if ((n = obt_xml_find_node(node, "animateIconify")))
         config_animate_iconify = obt_xml_node_bool(n);
+    if ((n = obt_xml_find_node(node, "singleWindowDecorations")))
+        config_theme_single_window = obt_xml_node_bool(n);
     if ((n = obt_xml_find_node(node, "windowListIconSize"))) {
         config_theme_window_list_icon_size = obt_xml_node_int(n);
         if (config_theme_window_list_icon_size < 16)
@@ -968,6 +973,15 @@ static void parse_menu(xmlNodePtr node, gpointer d)
     }
 }
 
+static void parse_control(xmlNodePtr node, gpointer d)
+{
+    xmlNodePtr n;
+
+    node = node->children;
+    if ((n = obt_xml_find_node(node, "socket")))
+        config_control_socket = obt_xml_node_bool(n);
+}
+
 static void parse_resistance(xmlNodePtr node, gpointer d)
 {
     xmlNodePtr n;
@@ -1095,6 +1109,7 @@ void config_startup(ObtXmlInst *i)
     config_theme = NULL;
 
     config_animate_iconify = TRUE;
+    config_theme_single_window = FALSE;
     config_title_layout = g_strdup("NLIMC");
     config_theme_keepborder = TRUE;
     config_theme_window_list_icon_size = 36;
@@ -1170,6 +1185,10 @@ void config_startup(ObtXmlInst *i)
 
     obt_xml_register(i, "menu", parse_menu, NULL);
 
+    config_control_socket = FALSE;
+
+    obt_xml_register(i, "control", parse_control, NULL);
+
     config_per_app_settings = NULL;
 
     obt_xml_register(i, "applications", parse_per_app_settings, NULL);
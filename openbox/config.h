@@ -150,6 +150,9 @@ extern gboolean config_theme_keepborder;
 extern gchar *config_title_layout;
 /*! Animate windows iconifying and restoring */
 extern gboolean config_animate_iconify;
+/*! Paint each window's decorations onto a single X window, instead of using
+  a window for each element of the decorations */
+extern gboolean config_theme_single_window;
 /*! Size of icons in focus switching dialogs */
 extern guint config_theme_window_list_icon_size;
 
@@ -216,6 +219,9 @@ extern GSList *config_menu_files;
 /*! Per app settings */
 extern GSList *config_per_app_settings;
 
+/*! Listen for actions to run on a unix domain socket */
+extern gboolean config_control_socket;
+
 void config_startup(ObtXmlInst *i);
 void config_shutdown(void);
 
@@ -0,0 +1,445 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   control.c for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "control.h"
+#include "openbox.h"
+#include "actions.h"
+#include "client.h"
+#include "config.h"
+#include "event.h"
+#include "metrics.h"
+#include "debug.h"
+#include "gettext.h"
+#include "obt/display.h"
+#include "obt/xml.h"
+
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#  include <sys/stat.h>
+#endif
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*! The largest request that will be read from a connection */
+#define MAX_REQUEST (1024 * 1024)
+/*! How long a connection may take to send its request and read the reply,
+  in milliseconds */
+#define CONN_TIMEOUT 10000
+/*! A request is complete once it ends with this, without waiting for the
+  other end to shut down its side of the connection */
+#define REQUEST_END "</openbox_control>"
+
+#ifndef MSG_NOSIGNAL
+/* not every system has it, and SIGPIPE will end openbox */
+#  define MSG_NOSIGNAL 0
+#endif
+
+typedef struct _ObControlConn ObControlConn;
+
+struct _ObControlConn {
+    gint fd;
+    guint watch;
+    guint timeout;
+    GString *request;
+    /* once the request has been run, what is being written back */
+    GString *reply;
+    gsize sent;
+};
+
+static gint    listen_fd = -1;
+static guint   listen_watch = 0;
+static gchar  *socket_path = NULL;
+static GSList *conns = NULL;
+
+static gboolean accept_handler(GIOChannel *source, GIOCondition cond,
+                               gpointer data);
+static gboolean conn_handler(GIOChannel *source, GIOCondition cond,
+                             gpointer data);
+static gboolean reply_handler(GIOChannel *source, GIOCondition cond,
+                              gpointer data);
+static gboolean conn_timeout(gpointer data);
+
+static guint add_watch(gint fd, GIOCondition cond, GIOFunc func,
+                       gpointer data)
+{
+    GIOChannel *ch;
+    guint id;
+
+    ch = g_io_channel_unix_new(fd);
+    id = g_io_add_watch(ch, cond | G_IO_HUP | G_IO_ERR, func, data);
+    g_io_channel_unref(ch);
+    return id;
+}
+
+static gchar* make_socket_path(void)
+{
+    gchar *dir, *disp, *name, *path, *p;
+    struct stat st;
+
+    dir = g_build_filename(g_get_user_runtime_dir(), "openbox", NULL);
+    if (g_mkdir_with_parents(dir, 0700) < 0) {
+        g_message(_("Unable to make directory \"%s\": %s"),
+                  dir, g_strerror(errno));
+        g_free(dir);
+        return NULL;
+    }
+    /* anyone who could write in the directory could take over the socket */
+    if (lstat(dir, &st) < 0 || !S_ISDIR(st.st_mode) ||
+        st.st_uid != getuid() || (st.st_mode & 0777) != 0700)
+    {
+        g_message(_("Not using the directory \"%s\" for the control socket, "
+                    "it must be a directory which only you can use"), dir);
+        g_free(dir);
+        return NULL;
+    }
+
+    /* the display name can contain a path on some systems */
+    disp = g_strdup(DisplayString(obt_display));
+    for (p = disp; *p; ++p)
+        if (*p == '/') *p = '_';
+    name = g_strdup_printf("control-%s-%d", disp, ob_screen);
+    path = g_build_filename(dir, name, NULL);
+
+    g_free(name);
+    g_free(disp);
+    g_free(dir);
+    return path;
+}
+
+void control_startup(gboolean reconfig)
+{
+    struct sockaddr_un addr;
+
+    if (!config_control_socket) return;
+
+    if (!(socket_path = make_socket_path()))
+        return;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        g_message(_("The control socket path \"%s\" is too long"),
+                  socket_path);
+        goto fail;
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) goto fail_errno;
+    fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+
+    /* we own the screen, so anything left here is from an old openbox */
+    g_unlink(socket_path);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+        goto fail_errno;
+    chmod(socket_path, 0600);
+    if (listen(listen_fd, 8) < 0)
+        goto fail_errno;
+
+    listen_watch = add_watch(listen_fd, G_IO_IN, accept_handler, NULL);
+    g_setenv(CONTROL_SOCKET_ENV, socket_path, TRUE);
+    ob_debug("Listening for control requests on %s", socket_path);
+    return;
+
+fail_errno:
+    g_message(_("Unable to open the control socket \"%s\": %s"),
+              socket_path, g_strerror(errno));
+fail:
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        g_unlink(socket_path);
+    }
+    g_free(socket_path);
+    socket_path = NULL;
+}
+
+static void conn_free(ObControlConn *c)
+{
+    conns = g_slist_remove(conns, c);
+    if (c->watch) g_source_remove(c->watch);
+    if (c->timeout) g_source_remove(c->timeout);
+    close(c->fd);
+    g_string_free(c->request, TRUE);
+    if (c->reply) g_string_free(c->reply, TRUE);
+    g_slice_free(ObControlConn, c);
+}
+
+void control_shutdown(gboolean reconfig)
+{
+    while (conns)
+        conn_free(conns->data);
+
+    if (listen_fd >= 0) {
+        g_source_remove(listen_watch);
+        listen_watch = 0;
+        close(listen_fd);
+        listen_fd = -1;
+        g_unlink(socket_path);
+        g_unsetenv(CONTROL_SOCKET_ENV);
+    }
+    g_free(socket_path);
+    socket_path = NULL;
+}
+
+static gboolean accept_handler(GIOChannel *source, GIOCondition cond,
+                               gpointer data)
+{
+    gint fd;
+
+    while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+        ObControlConn *c;
+
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+
+        c = g_slice_new(ObControlConn);
+        c->fd = fd;
+        c->request = g_string_new(NULL);
+        c->reply = NULL;
+        c->sent = 0;
+        c->watch = add_watch(fd, G_IO_IN, conn_handler, c);
+        /* don't let a client which never finishes hold the connection open
+           for as long as openbox runs */
+        c->timeout = g_timeout_add_full(G_PRIORITY_DEFAULT, CONN_TIMEOUT,
+                                        conn_timeout, c, NULL);
+        conns = g_slist_prepend(conns, c);
+    }
+    return TRUE; /* don't remove the event source */
+}
+
+static gboolean match(xmlNodePtr node, const gchar *attr, const gchar *val)
+{
+    gchar *pat;
+    gboolean ret;
+
+    if (!obt_xml_attr_string(node, attr, &pat))
+        return TRUE;
+    ret = val && g_pattern_match_simple(pat, val);
+    g_free(pat);
+    return ret;
+}
+
+/*! Returns the clients selected by a <run> element, or sets all to TRUE if
+  it does not select any */
+static GSList* select_clients(xmlNodePtr node, gboolean *all)
+{
+    GSList *sel = NULL;
+    GList *it;
+    gchar *s;
+    gulong win = 0;
+    gboolean by_window = FALSE;
+
+    *all = TRUE;
+    if (obt_xml_attr_string(node, "window", &s)) {
+        win = strtoul(s, NULL, 0);
+        g_free(s);
+        by_window = TRUE;
+        *all = FALSE;
+    }
+    if (xmlHasProp(node, (const xmlChar*)"class") ||
+        xmlHasProp(node, (const xmlChar*)"name") ||
+        xmlHasProp(node, (const xmlChar*)"role"))
+        *all = FALSE;
+    if (*all) return NULL;
+
+    for (it = client_list; it; it = g_list_next(it)) {
+        ObClient *c = it->data;
+
+        if (by_window && c->window != win) continue;
+        if (match(node, "class", c->class) &&
+            match(node, "name", c->name) &&
+            match(node, "role", c->role))
+            sel = g_slist_prepend(sel, c);
+    }
+    return g_slist_reverse(sel);
+}
+
+static void run(xmlNodePtr node, GString *reply)
+{
+    GSList *acts = NULL, *sel, *it;
+    xmlNodePtr n;
+    gboolean none;
+    guint count = 0;
+
+    for (n = obt_xml_find_node(node->children, "action"); n;
+         n = obt_xml_find_node(n->next, "action"))
+    {
+        ObActionsAct *a = actions_parse(n);
+
+        if (!a) {
+            g_string_append(reply, "error unknown action\n");
+            goto done;
+        }
+        acts = g_slist_append(acts, a);
+        /* nobody is at the keyboard to finish these */
+        if (actions_act_is_interactive(a)) {
+            g_string_append(reply,
+                            "error interactive actions are not allowed\n");
+            goto done;
+        }
+    }
+
+    sel = select_clients(node, &none);
+    if (none) {
+        actions_run_acts(acts, OB_USER_ACTION_NONE, 0, -1, -1, 0,
+                         OB_FRAME_CONTEXT_NONE, NULL);
+    }
+    for (it = sel; it; it = g_slist_next(it)) {
+        /* an earlier action may have made the client go away */
+        if (!g_list_find(client_list, it->data)) continue;
+
+        actions_run_acts(acts, OB_USER_ACTION_NONE, 0, -1, -1, 0,
+                         OB_FRAME_CONTEXT_NONE, it->data);
+        ++count;
+    }
+    g_slist_free(sel);
+    g_string_append_printf(reply, "ok %u\n", count);
+
+done:
+    for (it = acts; it; it = g_slist_next(it))
+        actions_act_unref(it->data);
+    g_slist_free(acts);
+}
+
+static void process(ObControlConn *c, GString *reply)
+{
+    ObtXmlInst *i;
+    xmlNodePtr node;
+
+    i = obt_xml_instance_new();
+    if (!obt_xml_load_mem(i, c->request->str, c->request->len,
+                          "openbox_control"))
+    {
+        /* the message belongs to the instance */
+        const gchar *m = obt_xml_last_error(i) ?
+            obt_xml_last_error_message(i) : NULL;
+        g_string_append_printf(reply, "error %s\n",
+                               m ? m : "expected an <openbox_control> document");
+        obt_xml_instance_unref(i);
+        return;
+    }
+
+    /* scripts don't give us timestamps, so get a current one for anything
+       which focuses windows */
+    event_reset_time();
+
+    for (node = obt_xml_root(i)->children; node; node = node->next) {
+        if (!xmlStrcmp(node->name, (const xmlChar*)"run"))
+            run(node, reply);
+        else if (!xmlStrcmp(node->name, (const xmlChar*)"metrics"))
+            metrics_export(reply);
+        else if (!xmlStrcmp(node->name, (const xmlChar*)"iconCache"))
+            RrImageCacheDump(ob_rr_icons, reply);
+    }
+
+    obt_xml_close(i);
+    obt_xml_instance_unref(i);
+}
+
+static gboolean conn_timeout(gpointer data)
+{
+    ObControlConn *c = data;
+
+    ob_debug("Dropping a control connection which took too long");
+    c->timeout = 0;
+    conn_free(c);
+    return FALSE; /* don't repeat */
+}
+
+/*! Returns TRUE if the request ends with the closing tag of the document */
+static gboolean request_complete(GString *request)
+{
+    const gsize elen = strlen(REQUEST_END);
+    gsize len = request->len;
+
+    while (len > 0 && g_ascii_isspace(request->str[len-1]))
+        --len;
+    return len >= elen &&
+        !memcmp(request->str + len - elen, REQUEST_END, elen);
+}
+
+static gboolean conn_handler(GIOChannel *source, GIOCondition cond,
+                             gpointer data)
+{
+    ObControlConn *c = data;
+    gchar buf[4096];
+    gssize n;
+
+    while ((n = read(c->fd, buf, sizeof(buf))) > 0) {
+        if (c->request->len + n > MAX_REQUEST) {
+            ob_debug("Dropping oversized control request");
+            c->watch = 0;
+            conn_free(c);
+            return FALSE; /* remove the event source */
+        }
+        g_string_append_len(c->request, buf, n);
+    }
+    /* the whole request is here once the other end stops writing, or once
+       the document has been closed */
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+        if (!request_complete(c->request))
+            return TRUE; /* wait for more */
+    }
+    else if (n < 0) {
+        c->watch = 0;
+        conn_free(c);
+        return FALSE; /* remove the event source */
+    }
+    c->reply = g_string_new(NULL);
+    process(c, c->reply);
+
+    /* the reply can be bigger than the socket will hold, and the other end
+       may be slow to read it, so send it as the socket has room */
+    c->watch = add_watch(c->fd, G_IO_OUT, reply_handler, c);
+    return FALSE; /* remove the event source */
+}
+
+static gboolean reply_handler(GIOChannel *source, GIOCondition cond,
+                              gpointer data)
+{
+    ObControlConn *c = data;
+    gssize n;
+
+    while (c->sent < c->reply->len) {
+        /* the other end may have gone away, which would raise SIGPIPE */
+        n = send(c->fd, c->reply->str + c->sent, c->reply->len - c->sent,
+                 MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN)
+            return TRUE; /* wait for more room */
+        if (n < 0) break; /* EPIPE or any other error drops the connection */
+        c->sent += n;
+    }
+
+    c->watch = 0;
+    conn_free(c);
+    return FALSE; /* remove the event source */
+}
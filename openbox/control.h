@@ -0,0 +1,63 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   control.h for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __ob__control_h
+#define __ob__control_h
+
+#include <glib.h>
+
+/*! The environment variable which tells programs run by Openbox where to find
+  the control socket */
+#define CONTROL_SOCKET_ENV "OPENBOX_CONTROL_SOCKET"
+
+/*! Opens the control socket if it is enabled in the configuration.
+
+  A program connects to the socket and writes an XML document.  The document
+  is run once it has been closed with </openbox_control>, or once the program
+  shuts down its side of the connection for writing.  A connection which has
+  not sent its request and read the reply within 10 seconds is dropped.  The
+  document looks like this:
+
+    <openbox_control>
+      <run window="0x1a00007">
+        <action name="MoveResizeTo"><x>0</x><y>0</y></action>
+      </run>
+      <run class="XTerm">
+        <action name="Iconify"/>
+      </run>
+      <run>
+        <action name="GoToDesktop"><to>2</to></action>
+      </run>
+    </openbox_control>
+
+  Every <run> runs its actions once for each client it selects.  A client is
+  selected by its window id, or by patterns matched against its class, name
+  and role.  A <run> with none of these runs its actions once without a
+  client.  All of the <run>s in a document are run together, and then one line
+  is written back for each of them, in order: "ok N" where N is the number of
+  clients the actions were run on, or "error MESSAGE".
+
+  A <metrics/> element writes back the counters from metrics.h, in the
+  Prometheus text format, at its place in the reply.  An <iconCache/>
+  element writes back every image in the icon cache and the sizes of the
+  pictures it holds.
+*/
+void control_startup(gboolean reconfig);
+void control_shutdown(gboolean reconfig);
+
+#endif
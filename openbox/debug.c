@@ -31,6 +31,9 @@
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>
 #endif
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>
+#endif
 
 static gboolean  enabled_types[OB_DEBUG_TYPE_NUM] = {FALSE};
 static FILE     *log_file = NULL;
@@ -62,6 +65,9 @@ void ob_debug_startup(void)
         /* unlink it before opening to remove competition */
         unlink(name);
         log_file = fopen(name, "w");
+        /* don't give it to the programs we run */
+        if (log_file)
+            fcntl(fileno(log_file), F_SETFD, FD_CLOEXEC);
         g_free(name);
     }
 
@@ -39,6 +39,7 @@
 #include "group.h"
 #include "stacking.h"
 #include "ping.h"
+#include "metrics.h"
 #include "obt/display.h"
 #include "obt/xqueue.h"
 #include "obt/prop.h"
@@ -460,6 +461,8 @@ static void event_process(const XEvent *ec, gpointer data)
     ObPrompt *prompt = NULL;
     gboolean used;
 
+    metrics_inc(OB_METRIC_EVENTS);
+
     /* make a copy we can mangle */
     ee = *ec;
     e = &ee;
@@ -927,6 +930,30 @@ static gboolean *context_to_button(ObFrame *f, ObFrameContext con, gboolean pres
     }
 }
 
+/*! A single-window decoration gets no crossing events between its elements,
+  so the hover state of every button follows the one element under the
+  pointer */
+static void decor_hover(ObFrame *f, ObFrameContext con)
+{
+    static const ObFrameContext buttons[] = {
+        OB_FRAME_CONTEXT_MAXIMIZE,
+        OB_FRAME_CONTEXT_CLOSE,
+        OB_FRAME_CONTEXT_ICONIFY,
+        OB_FRAME_CONTEXT_ALLDESKTOPS,
+        OB_FRAME_CONTEXT_SHADE
+    };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(buttons); ++i) {
+        gboolean *hover = context_to_button(f, buttons[i], FALSE);
+
+        if (*hover != (buttons[i] == con)) {
+            *hover = (buttons[i] == con);
+            frame_adjust_button(f, buttons[i]);
+        }
+    }
+}
+
 static gboolean more_client_message_event(Window window, Atom msgtype)
 {
     ObtXQueueWindowMessage wm;
@@ -1012,7 +1039,7 @@ static void event_handle_client(ObClient *client, XEvent *e)
             but = context_to_button(client->frame, con, TRUE);
             if (but) {
                 *but = (e->type == ButtonPress);
-                frame_adjust_state(client->frame);
+                frame_adjust_button(client->frame, con);
             }
         }
         break;
@@ -1023,6 +1050,13 @@ static void event_handle_client(ObClient *client, XEvent *e)
 
         con = frame_context(client, e->xmotion.window,
                             e->xmotion.x, e->xmotion.y);
+        if (e->xmotion.window == client->frame->decor) {
+            frame_set_pointer_context(client->frame, con);
+            /* only the pressed button lights up while a button is held */
+            decor_hover(client->frame,
+                        (!pb || con == pcon) ? con : OB_FRAME_CONTEXT_NONE);
+            break;
+        }
         switch (con) {
         case OB_FRAME_CONTEXT_TITLEBAR:
         case OB_FRAME_CONTEXT_TLCORNER:
@@ -1037,14 +1071,14 @@ static void event_handle_client(ObClient *client, XEvent *e)
                     client->frame->shade_hover =
                     client->frame->iconify_hover =
                     client->frame->close_hover = FALSE;
-                frame_adjust_state(client->frame);
+                frame_adjust_button(client->frame, OB_FRAME_CONTEXT_NONE);
             }
             break;
         default:
             but = context_to_button(client->frame, con, FALSE);
             if (but && !*but && !pb) {
                 *but = TRUE;
-                frame_adjust_state(client->frame);
+                frame_adjust_button(client->frame, con);
             }
             break;
         }
@@ -1052,6 +1086,18 @@ static void event_handle_client(ObClient *client, XEvent *e)
     case LeaveNotify:
         con = frame_context(client, e->xcrossing.window,
                             e->xcrossing.x, e->xcrossing.y);
+        if (e->xcrossing.window == client->frame->decor) {
+            decor_hover(client->frame, OB_FRAME_CONTEXT_NONE);
+            if (e->xcrossing.mode == NotifyGrab) {
+                client->frame->max_press =
+                    client->frame->desk_press =
+                    client->frame->shade_press =
+                    client->frame->iconify_press =
+                    client->frame->close_press = FALSE;
+                frame_adjust_button(client->frame, OB_FRAME_CONTEXT_NONE);
+            }
+            break;
+        }
         switch (con) {
         case OB_FRAME_CONTEXT_TITLEBAR:
         case OB_FRAME_CONTEXT_TLCORNER:
@@ -1104,7 +1150,7 @@ static void event_handle_client(ObClient *client, XEvent *e)
                     but = context_to_button(client->frame, con, TRUE);
                     *but = FALSE;
                 }
-                frame_adjust_state(client->frame);
+                frame_adjust_button(client->frame, con);
             }
             break;
         }
@@ -1113,6 +1159,17 @@ static void event_handle_client(ObClient *client, XEvent *e)
     {
         con = frame_context(client, e->xcrossing.window,
                             e->xcrossing.x, e->xcrossing.y);
+        if (e->xcrossing.window == client->frame->decor) {
+            frame_set_pointer_context(client->frame, con);
+            decor_hover(client->frame, con);
+            if (e->xcrossing.mode == NotifyUngrab &&
+                (but = context_to_button(client->frame, con, TRUE)))
+            {
+                *but = (con == pcon);
+                frame_adjust_button(client->frame, con);
+            }
+            break;
+        }
         switch (con) {
         case OB_FRAME_CONTEXT_FRAME:
             if (grab_on_keyboard())
@@ -1157,7 +1214,7 @@ static void event_handle_client(ObClient *client, XEvent *e)
                     but = context_to_button(client->frame, con, TRUE);
                     *but = (con == pcon);
                 }
-                frame_adjust_state(client->frame);
+                frame_adjust_button(client->frame, con);
             }
             break;
         }
@@ -2291,6 +2348,7 @@ static Time next_time(void)
 
     /* Grab the first timestamp available */
     xqueue_exists(find_timestamp, NULL);
+    obt_display_round_trip();
 
     /*g_assert(event_curtime != CurrentTime);*/
 
@@ -43,6 +43,14 @@ static gboolean focus_cycle_all_desktops;
 static gboolean focus_cycle_nonhilite_windows;
 static gboolean focus_cycle_dock_windows;
 static gboolean focus_cycle_desktop_windows;
+/*! A copy of the list being cycled through, so that each step of the cycle
+  can move by index instead of searching the list */
+static GPtrArray *focus_cycle_clients = NULL;
+/*! The position of focus_cycle_target in focus_cycle_clients, or -1 */
+static gint focus_cycle_pos = -1;
+/*! Set when the list being cycled through has changed, and
+  focus_cycle_clients needs to be built again */
+static gboolean focus_cycle_clients_stale = TRUE;
 
 static ObClient *focus_find_directional(ObClient *c,
                                         ObDirection dir,
@@ -52,11 +60,31 @@ static ObClient *focus_find_directional(ObClient *c,
 void focus_cycle_startup(gboolean reconfig)
 {
     if (reconfig) return;
+
+    focus_cycle_clients = g_ptr_array_new();
 }
 
 void focus_cycle_shutdown(gboolean reconfig)
 {
     if (reconfig) return;
+
+    g_ptr_array_free(focus_cycle_clients, TRUE);
+    focus_cycle_clients = NULL;
+}
+
+/*! Copies the list being cycled through, and finds the position of c in it */
+static void focus_cycle_copy_list(GList *list, ObClient *c)
+{
+    GList *it;
+
+    g_ptr_array_set_size(focus_cycle_clients, 0);
+    focus_cycle_pos = -1;
+    for (it = list; it; it = g_list_next(it)) {
+        if (it->data == c)
+            focus_cycle_pos = focus_cycle_clients->len;
+        g_ptr_array_add(focus_cycle_clients, it->data);
+    }
+    focus_cycle_clients_stale = FALSE;
 }
 
 void focus_cycle_addremove(ObClient *c, gboolean redraw)
@@ -64,6 +92,10 @@ void focus_cycle_addremove(ObClient *c, gboolean redraw)
     if (!focus_cycle_type)
         return;
 
+    /* a window was added or removed from the lists, or changed in a way that
+       can move it in them */
+    focus_cycle_clients_stale = TRUE;
+
     if (focus_cycle_type == OB_CYCLE_DIRECTIONAL) {
         if (c && focus_cycle_target == c) {
             focus_directional_cycle(0, TRUE, TRUE, TRUE, TRUE,
@@ -86,6 +118,8 @@ void focus_cycle_addremove(ObClient *c, gboolean redraw)
 
 void focus_cycle_reorder()
 {
+    focus_cycle_clients_stale = TRUE;
+
     if (focus_cycle_type == OB_CYCLE_NORMAL) {
         focus_cycle_target = focus_cycle_popup_refresh(focus_cycle_target,
                                                        TRUE,
@@ -106,7 +140,8 @@ ObClient* focus_cycle(gboolean forward, gboolean all_desktops,
                       gboolean done, gboolean cancel)
 {
     static GList *order = NULL;
-    GList *it, *start, *list;
+    GList *list;
+    gint i, start, n;
     ObClient *ft = NULL;
     ObClient *ret = NULL;
 
@@ -129,24 +164,32 @@ ObClient* focus_cycle(gboolean forward, gboolean all_desktops,
         focus_cycle_nonhilite_windows = nonhilite_windows;
         focus_cycle_dock_windows = dock_windows;
         focus_cycle_desktop_windows = desktop_windows;
-        start = it = g_list_find(list, focus_client);
-    } else
-        start = it = g_list_find(list, focus_cycle_target);
+        focus_cycle_copy_list(list, focus_client);
+    } else if (focus_cycle_clients_stale)
+        focus_cycle_copy_list(list, focus_cycle_target);
+    else if (focus_cycle_pos < 0 ||
+             g_ptr_array_index(focus_cycle_clients, focus_cycle_pos) !=
+             focus_cycle_target)
+    {
+        /* the target was moved by something other than cycling */
+        focus_cycle_copy_list(list, focus_cycle_target);
+    }
+
+    n = focus_cycle_clients->len;
+    if (n == 0) goto done_cycle;
 
-    if (!start) /* switched desktops or something? */
-        start = it = forward ? g_list_last(list) : g_list_first(list);
-    if (!start) goto done_cycle;
+    start = i = focus_cycle_pos;
+    if (start < 0) /* switched desktops or something? */
+        start = i = forward ? n - 1 : 0;
 
     do {
-        if (forward) {
-            it = it->next;
-            if (it == NULL) it = g_list_first(list);
-        } else {
-            it = it->prev;
-            if (it == NULL) it = g_list_last(list);
-        }
-        ft = it->data;
+        if (forward)
+            i = (i + 1) % n;
+        else
+            i = (i + n - 1) % n;
+        ft = g_ptr_array_index(focus_cycle_clients, i);
         if (focus_cycle_valid(ft)) {
+            focus_cycle_pos = i;
             if (ft != focus_cycle_target) { /* prevents flicker */
                 focus_cycle_target = ft;
                 focus_cycle_type = OB_CYCLE_NORMAL;
@@ -156,7 +199,7 @@ ObClient* focus_cycle(gboolean forward, gboolean all_desktops,
             focus_cycle_popup_show(ft, mode, focus_cycle_linear);
             return focus_cycle_target;
         }
-    } while (it != start);
+    } while (i != start);
 
 done_cycle:
     if (done && !cancel) ret = focus_cycle_target;
@@ -165,6 +208,9 @@ done_cycle:
     focus_cycle_type = OB_CYCLE_NONE;
     g_list_free(order);
     order = NULL;
+    g_ptr_array_set_size(focus_cycle_clients, 0);
+    focus_cycle_pos = -1;
+    focus_cycle_clients_stale = TRUE;
 
     focus_cycle_draw_indicator(NULL);
     focus_cycle_popup_hide();
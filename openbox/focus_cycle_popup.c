@@ -53,16 +53,35 @@
 typedef struct _ObFocusCyclePopup       ObFocusCyclePopup;
 typedef struct _ObFocusCyclePopupTarget ObFocusCyclePopupTarget;
 
+typedef struct _ObFocusCyclePopupLayout ObFocusCyclePopupLayout;
+
 struct _ObFocusCyclePopupTarget
 {
     ObClient *client;
     RrImage *icon;
     gchar *text;
+    /* The width of the text, measured when the target is created */
+    gint textw;
+    /* The position of the target in the popup's list of targets */
+    gint pos;
     Window iconwin;
     /* This is used when the popup is in list mode */
     Window textwin;
 };
 
+/* Where things go inside the popup, this is found each time it is rendered */
+struct _ObFocusCyclePopupLayout
+{
+    ObFocusCyclePopupMode mode;
+    gint l, t;
+    gint textw, texth;
+    gint icons_per_row;
+    gint icon_rows;
+    gint icons_center_x;
+    gint icon_mode_textx, icon_mode_texty;
+    gboolean showing_arrows;
+};
+
 struct _ObFocusCyclePopup
 {
     ObWindow obwin;
@@ -76,6 +95,8 @@ struct _ObFocusCyclePopup
 
     GList *targets;
     gint n_targets;
+    /* Maps from an ObClient to its ObFocusCyclePopupTarget */
+    GHashTable *target_table;
 
     const ObFocusCyclePopupTarget *last_target;
 
@@ -106,6 +127,10 @@ static gboolean popup_setup    (ObFocusCyclePopup *p,
                                 gboolean linear);
 static void     popup_render   (ObFocusCyclePopup *p,
                                 const ObClient *c);
+static void     popup_render_target(ObFocusCyclePopup *p,
+                                    const ObFocusCyclePopupTarget *target,
+                                    const ObFocusCyclePopupTarget *newtarget,
+                                    const ObFocusCyclePopupLayout *lay);
 
 static Window create_window(Window parent, guint bwidth, gulong mask,
                             XSetWindowAttributes *attr)
@@ -162,6 +187,7 @@ void focus_cycle_popup_startup(gboolean reconfig)
 
     popup.targets = NULL;
     popup.n_targets = 0;
+    popup.target_table = g_hash_table_new(g_direct_hash, g_direct_equal);
     popup.last_target = NULL;
 
     /* set up the hilite texture for the icon */
@@ -225,6 +251,8 @@ void focus_cycle_popup_shutdown(gboolean reconfig)
 
         popup.targets = g_list_delete_link(popup.targets, popup.targets);
     }
+    g_hash_table_destroy(popup.target_table);
+    popup.target_table = NULL;
 
     g_free(popup.a_icon->texture[1].data.rgba.data);
     popup.a_icon->texture[1].data.rgba.data = NULL;
@@ -243,6 +271,10 @@ void focus_cycle_popup_shutdown(gboolean reconfig)
 
 static void popup_target_free(ObFocusCyclePopupTarget *t)
 {
+    if (popup.last_target == t)
+        popup.last_target = NULL;
+    g_hash_table_remove(popup.target_table, t->client);
+
     RrImageUnref(t->icon);
     g_free(t->text);
     XDestroyWindow(obt_display, t->iconwin);
@@ -300,6 +332,9 @@ static gboolean popup_setup(ObFocusCyclePopup *p, gboolean create_targets,
                     p->targets = g_list_concat(rit, p->targets);
                     ++n;
 
+                    /* use the size it was measured at when it was created */
+                    maxwidth = MAX(maxwidth, t->textw);
+
                     if (rit != rtlast)
                         change = TRUE; /* order changed */
                     break;
@@ -309,9 +344,12 @@ static gboolean popup_setup(ObFocusCyclePopup *p, gboolean create_targets,
             if (!rit) {
                 gchar *text = popup_get_name(ft);
 
+                gint textw;
+
                 /* measure */
                 p->a_text->texture[0].data.text.string = text;
-                maxwidth = MAX(maxwidth, RrMinWidth(p->a_text));
+                textw = RrMinWidth(p->a_text);
+                maxwidth = MAX(maxwidth, textw);
 
                 if (!create_targets) {
                     g_free(text);
@@ -321,12 +359,14 @@ static gboolean popup_setup(ObFocusCyclePopup *p, gboolean create_targets,
 
                     t->client = ft;
                     t->text = text;
+                    t->textw = textw;
                     t->icon = client_icon(t->client);
                     RrImageRef(t->icon); /* own the icon so it won't go away */
                     t->iconwin = create_window(p->bg, 0, 0, NULL);
                     t->textwin = create_window(p->bg, 0, 0, NULL);
 
                     p->targets = g_list_prepend(p->targets, t);
+                    g_hash_table_insert(p->target_table, ft, t);
                     ++n;
 
                     change = TRUE; /* added a window */
@@ -344,6 +384,10 @@ static gboolean popup_setup(ObFocusCyclePopup *p, gboolean create_targets,
         }
     }
 
+    /* number the targets so they can be found without searching the list */
+    for (n = 0, it = p->targets; it; ++n, it = g_list_next(it))
+        ((ObFocusCyclePopupTarget*)it->data)->pos = n;
+
     p->n_targets = n;
     if (refresh_targets)
         /* don't shrink when refreshing */
@@ -397,9 +441,9 @@ static void popup_render(ObFocusCyclePopup *p, const ObClient *c)
     gint l, t, r, b;
     gint x, y, w, h;
     const Rect *screen_area = NULL;
-    gint i;
     GList *it;
     const ObFocusCyclePopupTarget *newtarget;
+    ObFocusCyclePopupLayout lay;
     ObFocusCyclePopupMode mode = p->mode;
     gint icons_per_row;
     gint icon_rows;
@@ -484,17 +528,9 @@ static void popup_render(ObFocusCyclePopup *p, const ObClient *c)
         h += OUTSIDE_BORDER + texth;
 
     /* find the focused target */
-    newtarget = NULL;
-    for (i = 0, it = p->targets; it; ++i, it = g_list_next(it)) {
-        const ObFocusCyclePopupTarget *target = it->data;
-        if (target->client == c) {
-            /* save the target */
-            newtarget = target;
-            break;
-        }
-    }
-    selected_pos = i;
+    newtarget = g_hash_table_lookup(p->target_table, c);
     g_assert(newtarget != NULL);
+    selected_pos = newtarget->pos;
 
     /* scroll the list if needed */
     last_scroll = p->scroll;
@@ -609,94 +645,29 @@ static void popup_render(ObFocusCyclePopup *p, const ObClient *c)
     }
 
     /* draw the icons and text */
-    for (i = 0, it = p->targets; it; ++i, it = g_list_next(it)) {
-        const ObFocusCyclePopupTarget *target = it->data;
+    lay.mode = mode;
+    lay.l = l;
+    lay.t = t;
+    lay.textw = textw;
+    lay.texth = texth;
+    lay.icons_per_row = icons_per_row;
+    lay.icon_rows = icon_rows;
+    lay.icons_center_x = icons_center_x;
+    if (mode == OB_FOCUS_CYCLE_POPUP_MODE_ICONS) {
+        lay.icon_mode_textx = icon_mode_textx;
+        lay.icon_mode_texty = icon_mode_texty;
+    }
+    lay.showing_arrows = showing_arrows;
 
+    if (!p->mapped || last_scroll != p->scroll) {
+        for (it = p->targets; it; it = g_list_next(it))
+            popup_render_target(p, it->data, newtarget, &lay);
+    } else {
         /* have to redraw the targetted icon and last targetted icon
-         * to update the hilite */
-        if (!p->mapped || newtarget == target || p->last_target == target ||
-            last_scroll != p->scroll)
-        {
-            /* row and column start from 0 */
-            const gint row = i / icons_per_row - p->scroll;
-            const gint col = i % icons_per_row;
-            gint iconx, icony;
-            gint list_mode_textx, list_mode_texty;
-            RrAppearance *text;
-
-            /* find the coordinates for the icon */
-            iconx = icons_center_x + l + (col * HILITE_SIZE);
-            icony = t + (showing_arrows ? ob_rr_theme->up_arrow_mask->height
-                                          + OUTSIDE_BORDER
-                         : 0)
-                + (row * MAX(texth, HILITE_SIZE))
-                + MAX(texth - HILITE_SIZE, 0) / 2;
-
-            /* find the dimensions of the text box */
-            list_mode_textx = iconx + HILITE_SIZE + TEXT_BORDER;
-            list_mode_texty = icony;
-
-            /* position the icon */
-            XMoveResizeWindow(obt_display, target->iconwin,
-                              iconx, icony, HILITE_SIZE, HILITE_SIZE);
-
-            /* position the text */
-            if (mode == OB_FOCUS_CYCLE_POPUP_MODE_LIST)
-                XMoveResizeWindow(obt_display, target->textwin,
-                                  list_mode_textx, list_mode_texty,
-                                  textw, texth);
-
-            /* show/hide the right windows */
-            if (row >= 0 && row < icon_rows) {
-                XMapWindow(obt_display, target->iconwin);
-                if (mode == OB_FOCUS_CYCLE_POPUP_MODE_LIST)
-                    XMapWindow(obt_display, target->textwin);
-                else
-                    XUnmapWindow(obt_display, target->textwin);
-            } else {
-                XUnmapWindow(obt_display, target->textwin);
-                if (mode == OB_FOCUS_CYCLE_POPUP_MODE_LIST)
-                    XUnmapWindow(obt_display, target->iconwin);
-                else
-                    XMapWindow(obt_display, target->iconwin);
-            }
-
-            /* get the icon from the client */
-            p->a_icon->texture[0].data.image.twidth = ICON_SIZE;
-            p->a_icon->texture[0].data.image.theight = ICON_SIZE;
-            p->a_icon->texture[0].data.image.tx = HILITE_OFFSET;
-            p->a_icon->texture[0].data.image.ty = HILITE_OFFSET;
-            p->a_icon->texture[0].data.image.alpha =
-                target->client->iconic ? OB_ICONIC_ALPHA : 0xff;
-            p->a_icon->texture[0].data.image.image = target->icon;
-
-            /* Draw the hilite? */
-            p->a_icon->texture[1].type = (target == newtarget) ?
-                RR_TEXTURE_RGBA : RR_TEXTURE_NONE;
-
-            /* draw the icon */
-            p->a_icon->surface.parentx = iconx;
-            p->a_icon->surface.parenty = icony;
-            RrPaint(p->a_icon, target->iconwin, HILITE_SIZE, HILITE_SIZE);
-
-            /* draw the text */
-            if (mode == OB_FOCUS_CYCLE_POPUP_MODE_LIST ||
-                target == newtarget)
-            {
-                text = (target == newtarget) ? p->a_hilite_text : p->a_text;
-                text->texture[0].data.text.string = target->text;
-                text->surface.parentx =
-                    mode == OB_FOCUS_CYCLE_POPUP_MODE_ICONS ?
-                    icon_mode_textx : list_mode_textx;
-                text->surface.parenty =
-                    mode == OB_FOCUS_CYCLE_POPUP_MODE_ICONS ?
-                    icon_mode_texty : list_mode_texty;
-                RrPaint(text,
-                        (mode == OB_FOCUS_CYCLE_POPUP_MODE_ICONS ?
-                         p->icon_mode_text : target->textwin),
-                        textw, texth);
-            }
-        }
+         * to update the hilite, and nothing else has changed */
+        if (p->last_target && p->last_target != newtarget)
+            popup_render_target(p, p->last_target, newtarget, &lay);
+        popup_render_target(p, newtarget, newtarget, &lay);
     }
 
     p->last_target = newtarget;
@@ -704,6 +675,93 @@ static void popup_render(ObFocusCyclePopup *p, const ObClient *c)
     XFlush(obt_display);
 }
 
+static void popup_render_target(ObFocusCyclePopup *p,
+                                const ObFocusCyclePopupTarget *target,
+                                const ObFocusCyclePopupTarget *newtarget,
+                                const ObFocusCyclePopupLayout *lay)
+{
+    /* row and column start from 0 */
+    const gint row = target->pos / lay->icons_per_row - p->scroll;
+    const gint col = target->pos % lay->icons_per_row;
+    const ObFocusCyclePopupMode mode = lay->mode;
+    gint iconx, icony;
+    gint list_mode_textx, list_mode_texty;
+    RrAppearance *text;
+
+    /* find the coordinates for the icon */
+    iconx = lay->icons_center_x + lay->l + (col * HILITE_SIZE);
+    icony = lay->t + (lay->showing_arrows ?
+                      ob_rr_theme->up_arrow_mask->height + OUTSIDE_BORDER
+                      : 0)
+        + (row * MAX(lay->texth, HILITE_SIZE))
+        + MAX(lay->texth - HILITE_SIZE, 0) / 2;
+
+    /* find the dimensions of the text box */
+    list_mode_textx = iconx + HILITE_SIZE + TEXT_BORDER;
+    list_mode_texty = icony;
+
+    /* position the icon */
+    XMoveResizeWindow(obt_display, target->iconwin,
+                      iconx, icony, HILITE_SIZE, HILITE_SIZE);
+
+    /* position the text */
+    if (mode == OB_FOCUS_CYCLE_POPUP_MODE_LIST)
+        XMoveResizeWindow(obt_display, target->textwin,
+                          list_mode_textx, list_mode_texty,
+                          lay->textw, lay->texth);
+
+    /* show/hide the right windows */
+    if (row >= 0 && row < lay->icon_rows) {
+        XMapWindow(obt_display, target->iconwin);
+        if (mode == OB_FOCUS_CYCLE_POPUP_MODE_LIST)
+            XMapWindow(obt_display, target->textwin);
+        else
+            XUnmapWindow(obt_display, target->textwin);
+    } else {
+        XUnmapWindow(obt_display, target->textwin);
+        if (mode == OB_FOCUS_CYCLE_POPUP_MODE_LIST)
+            XUnmapWindow(obt_display, target->iconwin);
+        else
+            XMapWindow(obt_display, target->iconwin);
+    }
+
+    /* get the icon from the client */
+    p->a_icon->texture[0].data.image.twidth = ICON_SIZE;
+    p->a_icon->texture[0].data.image.theight = ICON_SIZE;
+    p->a_icon->texture[0].data.image.tx = HILITE_OFFSET;
+    p->a_icon->texture[0].data.image.ty = HILITE_OFFSET;
+    p->a_icon->texture[0].data.image.alpha =
+        target->client->iconic ? OB_ICONIC_ALPHA : 0xff;
+    p->a_icon->texture[0].data.image.image = target->icon;
+
+    /* Draw the hilite? */
+    p->a_icon->texture[1].type = (target == newtarget) ?
+        RR_TEXTURE_RGBA : RR_TEXTURE_NONE;
+
+    /* draw the icon */
+    p->a_icon->surface.parentx = iconx;
+    p->a_icon->surface.parenty = icony;
+    RrPaint(p->a_icon, target->iconwin, HILITE_SIZE, HILITE_SIZE);
+
+    /* draw the text */
+    if (mode == OB_FOCUS_CYCLE_POPUP_MODE_LIST ||
+        target == newtarget)
+    {
+        text = (target == newtarget) ? p->a_hilite_text : p->a_text;
+        text->texture[0].data.text.string = target->text;
+        text->surface.parentx =
+            mode == OB_FOCUS_CYCLE_POPUP_MODE_ICONS ?
+            lay->icon_mode_textx : list_mode_textx;
+        text->surface.parenty =
+            mode == OB_FOCUS_CYCLE_POPUP_MODE_ICONS ?
+            lay->icon_mode_texty : list_mode_texty;
+        RrPaint(text,
+                (mode == OB_FOCUS_CYCLE_POPUP_MODE_ICONS ?
+                 p->icon_mode_text : target->textwin),
+                lay->textw, lay->texth);
+    }
+}
+
 void focus_cycle_popup_show(ObClient *c, ObFocusCyclePopupMode mode,
                             gboolean linear)
 {
@@ -782,16 +840,7 @@ void focus_cycle_popup_single_hide(void)
 
 gboolean focus_cycle_popup_is_showing(ObClient *c)
 {
-    if (popup.mapped) {
-        GList *it;
-
-        for (it = popup.targets; it; it = g_list_next(it)) {
-            ObFocusCyclePopupTarget *t = it->data;
-            if (t->client == c)
-                return TRUE;
-        }
-    }
-    return FALSE;
+    return popup.mapped && g_hash_table_lookup(popup.target_table, c);
 }
 
 static ObClient* popup_revert(ObClient *target)
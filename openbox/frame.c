@@ -19,6 +19,7 @@
 
 #include "frame.h"
 #include "client.h"
+#include "animation.h"
 #include "openbox.h"
 #include "grab.h"
 #include "debug.h"
@@ -41,18 +42,21 @@
                            EnterWindowMask | LeaveWindowMask)
 
 #define FRAME_ANIMATE_ICONIFY_TIME 150000 /* .15 seconds */
-#define FRAME_ANIMATE_ICONIFY_STEP_TIME (1000 / 60) /* 60 Hz */
+#define FRAME_FLASH_TIME (G_USEC_PER_SEC * 5) /* 5 seconds */
+#define FRAME_FLASH_STEP_TIME 600000 /* .6 seconds */
 
 #define FRAME_HANDLE_Y(f) (f->size.top + f->client->area.height + f->cbwidth_b)
 
 static void flash_done(gpointer data);
-static gboolean flash_timeout(gpointer data);
+static gboolean flash_step(gdouble progress, gpointer data);
 
 static void layout_title(ObFrame *self);
 static void set_theme_statics(ObFrame *self);
 static void free_theme_statics(ObFrame *self);
-static gboolean frame_animate_iconify(gpointer self);
+static gboolean frame_animate_iconify(gdouble progress, gpointer self);
+static void frame_iconify_animation_done(gpointer data);
 static void frame_adjust_cursors(ObFrame *self);
+static void set_cursors(ObFrame *self);
 
 static Window createWindow(Window parent, Visual *visual,
                            gulong mask, XSetWindowAttributes *attrib)
@@ -83,48 +87,82 @@ static Visual *check_32bit_client(ObClient *c)
     return NULL;
 }
 
-ObFrame *frame_new(ObClient *client)
-{
-    XSetWindowAttributes attrib;
-    gulong mask;
-    ObFrame *self;
-    Visual *visual;
-
-    self = g_slice_new0(ObFrame);
-    self->client = client;
+/* the windows making up the decorations when not in single-window mode, in
+   the order they are created, so parents always come before their children */
+#define FRAME_NUM_ELEMENTS 42
 
-    visual = check_32bit_client(client);
+static void get_elements(ObFrame *self, Window *w[FRAME_NUM_ELEMENTS])
+{
+    guint i = 0;
+
+    w[i++] = &self->innerleft;
+    w[i++] = &self->innertop;
+    w[i++] = &self->innerright;
+    w[i++] = &self->innerbottom;
+    w[i++] = &self->innerblb;
+    w[i++] = &self->innerbrb;
+    w[i++] = &self->innerbll;
+    w[i++] = &self->innerbrr;
+    w[i++] = &self->title;
+    w[i++] = &self->titleleft;
+    w[i++] = &self->titletop;
+    w[i++] = &self->titletopleft;
+    w[i++] = &self->titletopright;
+    w[i++] = &self->titleright;
+    w[i++] = &self->titlebottom;
+    w[i++] = &self->topresize;
+    w[i++] = &self->tltresize;
+    w[i++] = &self->tllresize;
+    w[i++] = &self->trtresize;
+    w[i++] = &self->trrresize;
+    w[i++] = &self->left;
+    w[i++] = &self->right;
+    w[i++] = &self->label;
+    w[i++] = &self->max;
+    w[i++] = &self->close;
+    w[i++] = &self->desk;
+    w[i++] = &self->shade;
+    w[i++] = &self->icon;
+    w[i++] = &self->iconify;
+    w[i++] = &self->handle;
+    w[i++] = &self->lgrip;
+    w[i++] = &self->rgrip;
+    w[i++] = &self->handleleft;
+    w[i++] = &self->handleright;
+    w[i++] = &self->handletop;
+    w[i++] = &self->handlebottom;
+    w[i++] = &self->lgripleft;
+    w[i++] = &self->lgriptop;
+    w[i++] = &self->lgripbottom;
+    w[i++] = &self->rgripright;
+    w[i++] = &self->rgriptop;
+    w[i++] = &self->rgripbottom;
+    g_assert(i == FRAME_NUM_ELEMENTS);
+}
 
-    /* create the non-visible decor windows */
+/* attributes for the visible decor windows */
+static gulong element_attributes(ObFrame *self, XSetWindowAttributes *attrib)
+{
+    gulong mask = CWEventMask;
 
-    mask = 0;
-    if (visual) {
+    attrib->event_mask = ELEMENT_EVENTMASK;
+    if (self->colormap) {
         /* client has a 32-bit visual */
-        mask = CWColormap | CWBackPixel | CWBorderPixel;
-        /* create a colormap with the visual */
-        self->colormap = attrib.colormap =
-            XCreateColormap(obt_display, obt_root(ob_screen),
-                            visual, AllocNone);
-        attrib.background_pixel = BlackPixel(obt_display, ob_screen);
-        attrib.border_pixel = BlackPixel(obt_display, ob_screen);
+        mask |= CWColormap | CWBackPixel | CWBorderPixel;
+        attrib->colormap = RrColormap(ob_rr_inst);
+        attrib->background_pixel = BlackPixel(obt_display, ob_screen);
+        attrib->border_pixel = BlackPixel(obt_display, ob_screen);
     }
-    self->window = createWindow(obt_root(ob_screen), visual,
-                                mask, &attrib);
-
-    /* create the visible decor windows */
+    return mask;
+}
 
-    mask = 0;
-    if (visual) {
-        /* client has a 32-bit visual */
-        mask = CWColormap | CWBackPixel | CWBorderPixel;
-        attrib.colormap = RrColormap(ob_rr_inst);
-    }
+static void create_elements(ObFrame *self)
+{
+    XSetWindowAttributes attrib;
+    gulong mask;
 
-    self->backback = createWindow(self->window, NULL, mask, &attrib);
-    self->backfront = createWindow(self->backback, NULL, mask, &attrib);
+    mask = element_attributes(self, &attrib);
 
-    mask |= CWEventMask;
-    attrib.event_mask = ELEMENT_EVENTMASK;
     self->innerleft = createWindow(self->window, NULL, mask, &attrib);
     self->innertop = createWindow(self->window, NULL, mask, &attrib);
     self->innerright = createWindow(self->window, NULL, mask, &attrib);
@@ -176,10 +214,96 @@ ObFrame *frame_new(ObClient *client)
     self->rgriptop = createWindow(self->window, NULL, mask, &attrib);
     self->rgripbottom = createWindow(self->window, NULL, mask, &attrib);
 
-    self->focused = FALSE;
-
     /* the other stuff is shown based on decor settings */
     XMapWindow(obt_display, self->label);
+}
+
+static void create_decor(ObFrame *self)
+{
+    XSetWindowAttributes attrib;
+    gulong mask;
+
+    mask = element_attributes(self, &attrib);
+    self->decor = createWindow(self->window, NULL, mask, &attrib);
+    /* it covers the whole frame, so keep it below the client and backback */
+    XLowerWindow(obt_display, self->decor);
+    XMapWindow(obt_display, self->decor);
+    self->decor_context = OB_FRAME_NUM_CONTEXTS;
+}
+
+static void add_decor_windows(ObFrame *self)
+{
+    if (self->single)
+        window_add(&self->decor, CLIENT_AS_WINDOW(self->client));
+    else {
+        Window *w[FRAME_NUM_ELEMENTS];
+        guint i;
+
+        get_elements(self, w);
+        for (i = 0; i < FRAME_NUM_ELEMENTS; ++i)
+            window_add(w[i], CLIENT_AS_WINDOW(self->client));
+    }
+}
+
+static void remove_decor_windows(ObFrame *self)
+{
+    if (self->single)
+        window_remove(self->decor);
+    else {
+        Window *w[FRAME_NUM_ELEMENTS];
+        guint i;
+
+        get_elements(self, w);
+        for (i = 0; i < FRAME_NUM_ELEMENTS; ++i)
+            window_remove(*w[i]);
+    }
+}
+
+ObFrame *frame_new(ObClient *client)
+{
+    XSetWindowAttributes attrib;
+    gulong mask;
+    ObFrame *self;
+    Visual *visual;
+
+    self = g_slice_new0(ObFrame);
+    self->client = client;
+
+    visual = check_32bit_client(client);
+
+    /* create the non-visible decor windows */
+
+    mask = 0;
+    if (visual) {
+        /* client has a 32-bit visual */
+        mask = CWColormap | CWBackPixel | CWBorderPixel;
+        /* create a colormap with the visual */
+        self->colormap = attrib.colormap =
+            XCreateColormap(obt_display, obt_root(ob_screen),
+                            visual, AllocNone);
+        attrib.background_pixel = BlackPixel(obt_display, ob_screen);
+        attrib.border_pixel = BlackPixel(obt_display, ob_screen);
+    }
+    self->window = createWindow(obt_root(ob_screen), visual,
+                                mask, &attrib);
+
+    /* create the visible decor windows */
+
+    mask = 0;
+    if (visual) {
+        /* client has a 32-bit visual */
+        mask = CWColormap | CWBackPixel | CWBorderPixel;
+        attrib.colormap = RrColormap(ob_rr_inst);
+    }
+
+    self->backback = createWindow(self->window, NULL, mask, &attrib);
+    self->backfront = createWindow(self->backback, NULL, mask, &attrib);
+
+    /* the decoration windows are made by frame_realize() */
+    self->single = config_theme_single_window;
+
+    self->focused = FALSE;
+
     XMapWindow(obt_display, self->backback);
     XMapWindow(obt_display, self->backfront);
 
@@ -199,6 +323,9 @@ ObFrame *frame_new(ObClient *client)
 
 static void set_theme_statics(ObFrame *self)
 {
+    /* there are no element windows to size */
+    if (self->single || !self->realized) return;
+
     /* set colors/appearance/sizes for stuff that doesn't change */
     XResizeWindow(obt_display, self->max,
                   ob_rr_theme->button_size, ob_rr_theme->button_size);
@@ -231,16 +358,37 @@ void frame_free(ObFrame *self)
     free_theme_statics(self);
 
     XDestroyWindow(obt_display, self->window);
+    if (self->decor_pixmap)
+        XFreePixmap(obt_display, self->decor_pixmap);
     if (self->colormap)
         XFreeColormap(obt_display, self->colormap);
 
     g_slice_free(ObFrame, self);
 }
 
+/*! Create the decoration windows, the first time the frame is shown */
+static void frame_realize(ObFrame *self)
+{
+    if (self->realized) return;
+
+    if (self->single)
+        create_decor(self);
+    else
+        create_elements(self);
+    add_decor_windows(self);
+    self->realized = TRUE;
+
+    set_theme_statics(self);
+    set_cursors(self);
+    /* put the new windows in place and paint them */
+    frame_adjust_area(self, FALSE, TRUE, FALSE);
+}
+
 void frame_show(ObFrame *self)
 {
     if (!self->visible) {
         self->visible = TRUE;
+        frame_realize(self);
         framerender_frame(self);
         /* Grab the server to make sure that the frame window is mapped before
            the client gets its MapNotify, i.e. to make sure the client is
@@ -252,6 +400,44 @@ void frame_show(ObFrame *self)
     }
 }
 
+void frame_show_batch(GSList *frames)
+{
+    GSList *it, *show = NULL;
+
+    /* render everything first, so the server is only grabbed while the
+       windows are being mapped */
+    for (it = frames; it; it = g_slist_next(it)) {
+        ObFrame *f = it->data;
+        if (!f->visible) {
+            f->visible = TRUE;
+            frame_realize(f);
+            framerender_frame(f);
+            show = g_slist_prepend(show, f);
+        }
+    }
+    if (!show) return;
+    show = g_slist_reverse(show);
+
+    /* one grab for all the frames, for the same reason as in frame_show() */
+    grab_server(TRUE);
+    for (it = show; it; it = g_slist_next(it)) {
+        ObFrame *f = it->data;
+        XMapWindow(obt_display, f->client->window);
+        XMapWindow(obt_display, f->window);
+    }
+    grab_server(FALSE);
+
+    g_slist_free(show);
+}
+
+void frame_hide_batch(GSList *frames)
+{
+    GSList *it;
+
+    for (it = frames; it; it = g_slist_next(it))
+        frame_hide(it->data);
+}
+
 void frame_hide(ObFrame *self)
 {
     if (self->visible) {
@@ -265,9 +451,49 @@ void frame_hide(ObFrame *self)
     }
 }
 
+/*! Switch between painting the decoration onto one window and using a window
+  for each of its elements */
+static void set_single(ObFrame *self, gboolean single)
+{
+    Window *w[FRAME_NUM_ELEMENTS];
+    gint i;
+
+    if (self->single == single) return;
+    if (!self->realized) {
+        /* it will be made the right way when it is shown */
+        self->single = single;
+        return;
+    }
+
+    remove_decor_windows(self);
+    if (single) {
+        get_elements(self, w);
+        /* destroy children before their parents */
+        for (i = FRAME_NUM_ELEMENTS - 1; i >= 0; --i) {
+            XDestroyWindow(obt_display, *w[i]);
+            *w[i] = None;
+        }
+        create_decor(self);
+    } else {
+        XDestroyWindow(obt_display, self->decor);
+        self->decor = None;
+        if (self->decor_pixmap) {
+            XFreePixmap(obt_display, self->decor_pixmap);
+            self->decor_pixmap = None;
+        }
+        create_elements(self);
+    }
+    self->single = single;
+    add_decor_windows(self);
+
+    set_cursors(self);
+    self->damage = OB_FRAME_DAMAGE_ALL;
+}
+
 void frame_adjust_theme(ObFrame *self)
 {
     free_theme_statics(self);
+    set_single(self, config_theme_single_window);
     set_theme_statics(self);
 }
 
@@ -401,7 +627,7 @@ void frame_adjust_area(ObFrame *self, gboolean moved,
 
         /* position/size and map/unmap all the windows */
 
-        if (!fake) {
+        if (!fake && self->realized && !self->single) {
             gint innercornerheight =
                 ob_rr_theme->grip_width - self->size.bottom;
 
@@ -601,7 +827,7 @@ void frame_adjust_area(ObFrame *self, gboolean moved,
             /* layout the title bar elements */
             layout_title(self);
 
-        if (!fake) {
+        if (!fake && self->realized && !self->single) {
             gint sidebwidth = self->max_horz ? 0 : self->bwidth;
 
             if (self->bwidth && self->size.bottom) {
@@ -809,6 +1035,15 @@ void frame_adjust_area(ObFrame *self, gboolean moved,
                 XMapWindow(obt_display, self->right);
             } else
                 XUnmapWindow(obt_display, self->right);
+        }
+
+        if (!fake) {
+            if (self->realized && self->single)
+                XResizeWindow(obt_display, self->decor,
+                              self->client->area.width +
+                              self->size.left + self->size.right,
+                              self->client->area.height +
+                              self->size.top + self->size.bottom);
 
             XMoveResizeWindow(obt_display, self->backback,
                               self->size.left, self->size.top,
@@ -856,7 +1091,7 @@ void frame_adjust_area(ObFrame *self, gboolean moved,
                     self->size.left, self->size.top);
 
         if (resized) {
-            self->need_render = TRUE;
+            self->damage = OB_FRAME_DAMAGE_ALL;
             framerender_frame(self);
             frame_adjust_shape(self);
         }
@@ -880,7 +1115,7 @@ void frame_adjust_area(ObFrame *self, gboolean moved,
             focus_cycle_update_indicator(self->client);
     }
     if (resized && (self->decorations & OB_FRAME_DECOR_TITLEBAR) &&
-        self->label_width)
+        self->label_width && self->realized && !self->single)
     {
         XResizeWindow(obt_display, self->label, self->label_width,
                       ob_rr_theme->label_height);
@@ -895,6 +1130,19 @@ static void frame_adjust_cursors(ObFrame *self)
         self->max_vert != self->client->max_vert ||
         self->shaded != self->client->shaded)
     {
+        set_cursors(self);
+    }
+}
+
+static void set_cursors(ObFrame *self)
+{
+    if (!self->realized) return;
+
+    if (self->single) {
+        /* chosen again the next time the pointer moves over the decor */
+        self->decor_context = OB_FRAME_NUM_CONTEXTS;
+        XUndefineCursor(obt_display, self->decor);
+    } else {
         gboolean r = (self->client->functions & OB_CLIENT_FUNC_RESIZE) &&
             !(self->client->max_horz && self->client->max_vert);
         gboolean topbot = !self->client->max_vert;
@@ -962,7 +1210,8 @@ void frame_adjust_client_area(ObFrame *self)
 
 void frame_adjust_state(ObFrame *self)
 {
-    self->need_render = TRUE;
+    /* the toggled states show in the buttons */
+    self->damage |= OB_FRAME_DAMAGE_BUTTONS;
     framerender_frame(self);
 }
 
@@ -972,20 +1221,45 @@ void frame_adjust_focus(ObFrame *self, gboolean hilite)
                   "Frame for 0x%x has focus: %d",
                   self->client->window, hilite);
     self->focused = hilite;
-    self->need_render = TRUE;
+    self->damage = OB_FRAME_DAMAGE_ALL;
     framerender_frame(self);
     XFlush(obt_display);
 }
 
 void frame_adjust_title(ObFrame *self)
 {
-    self->need_render = TRUE;
+    self->damage |= OB_FRAME_DAMAGE_LABEL;
     framerender_frame(self);
 }
 
 void frame_adjust_icon(ObFrame *self)
 {
-    self->need_render = TRUE;
+    self->damage |= OB_FRAME_DAMAGE_ICON;
+    framerender_frame(self);
+}
+
+void frame_adjust_button(ObFrame *self, ObFrameContext con)
+{
+    switch (con) {
+    case OB_FRAME_CONTEXT_MAXIMIZE:
+        self->damage |= OB_FRAME_DAMAGE_MAX;
+        break;
+    case OB_FRAME_CONTEXT_CLOSE:
+        self->damage |= OB_FRAME_DAMAGE_CLOSE;
+        break;
+    case OB_FRAME_CONTEXT_ALLDESKTOPS:
+        self->damage |= OB_FRAME_DAMAGE_DESK;
+        break;
+    case OB_FRAME_CONTEXT_SHADE:
+        self->damage |= OB_FRAME_DAMAGE_SHADE;
+        break;
+    case OB_FRAME_CONTEXT_ICONIFY:
+        self->damage |= OB_FRAME_DAMAGE_ICONIFY;
+        break;
+    default:
+        self->damage |= OB_FRAME_DAMAGE_BUTTONS;
+        break;
+    }
     framerender_frame(self);
 }
 
@@ -1016,48 +1290,9 @@ void frame_grab_client(ObFrame *self)
     window_add(&self->window, CLIENT_AS_WINDOW(self->client));
     window_add(&self->backback, CLIENT_AS_WINDOW(self->client));
     window_add(&self->backfront, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->innerleft, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->innertop, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->innerright, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->innerbottom, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->innerblb, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->innerbll, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->innerbrb, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->innerbrr, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->title, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->label, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->max, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->close, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->desk, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->shade, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->icon, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->iconify, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->handle, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->lgrip, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->rgrip, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->topresize, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->tltresize, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->tllresize, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->trtresize, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->trrresize, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->left, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->right, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->titleleft, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->titletop, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->titletopleft, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->titletopright, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->titleright, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->titlebottom, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->handleleft, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->handletop, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->handleright, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->handlebottom, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->lgripleft, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->lgriptop, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->lgripbottom, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->rgripright, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->rgriptop, CLIENT_AS_WINDOW(self->client));
-    window_add(&self->rgripbottom, CLIENT_AS_WINDOW(self->client));
+    /* otherwise frame_realize() adds them when they are made */
+    if (self->realized)
+        add_decor_windows(self);
 }
 
 static gboolean find_reparent(XEvent *e, gpointer data)
@@ -1074,7 +1309,7 @@ void frame_release_client(ObFrame *self)
 {
     /* if there was any animation going on, kill it */
     if (self->iconify_animation_timer)
-        g_source_remove(self->iconify_animation_timer);
+        animation_remove(self->iconify_animation_timer);
 
     /* check if the app has already reparented its window away */
     if (!xqueue_exists_local(find_reparent, self)) {
@@ -1088,50 +1323,10 @@ void frame_release_client(ObFrame *self)
     window_remove(self->window);
     window_remove(self->backback);
     window_remove(self->backfront);
-    window_remove(self->innerleft);
-    window_remove(self->innertop);
-    window_remove(self->innerright);
-    window_remove(self->innerbottom);
-    window_remove(self->innerblb);
-    window_remove(self->innerbll);
-    window_remove(self->innerbrb);
-    window_remove(self->innerbrr);
-    window_remove(self->title);
-    window_remove(self->label);
-    window_remove(self->max);
-    window_remove(self->close);
-    window_remove(self->desk);
-    window_remove(self->shade);
-    window_remove(self->icon);
-    window_remove(self->iconify);
-    window_remove(self->handle);
-    window_remove(self->lgrip);
-    window_remove(self->rgrip);
-    window_remove(self->topresize);
-    window_remove(self->tltresize);
-    window_remove(self->tllresize);
-    window_remove(self->trtresize);
-    window_remove(self->trrresize);
-    window_remove(self->left);
-    window_remove(self->right);
-    window_remove(self->titleleft);
-    window_remove(self->titletop);
-    window_remove(self->titletopleft);
-    window_remove(self->titletopright);
-    window_remove(self->titleright);
-    window_remove(self->titlebottom);
-    window_remove(self->handleleft);
-    window_remove(self->handletop);
-    window_remove(self->handleright);
-    window_remove(self->handlebottom);
-    window_remove(self->lgripleft);
-    window_remove(self->lgriptop);
-    window_remove(self->lgripbottom);
-    window_remove(self->rgripright);
-    window_remove(self->rgriptop);
-    window_remove(self->rgripbottom);
-
-    if (self->flash_timer) g_source_remove(self->flash_timer);
+    if (self->realized)
+        remove_decor_windows(self);
+
+    if (self->flash_timer) animation_remove(self->flash_timer);
 }
 
 /* is there anything present between us and the label? */
@@ -1247,6 +1442,9 @@ static void layout_title(ObFrame *self)
         }
     }
 
+    /* the single-window decoration is painted from the positions above */
+    if (self->single || !self->realized) return;
+
     /* position and map the elements */
     if (self->icon_on) {
         XMapWindow(obt_display, self->icon);
@@ -1390,6 +1588,202 @@ ObFrameContext frame_context_from_string(const gchar *name)
     return OB_FRAME_CONTEXT_NONE;
 }
 
+/* the context for a click in the corners of the titlebar of a fully
+   maximized window, at a position relative to the whole frame */
+static ObFrameContext maxed_title_context(ObFrame *self, gint fx, gint fy)
+{
+    /* figure out if we're over the area that should be considered a
+       button */
+    if (fy < self->bwidth + ob_rr_theme->paddingy + 1 +
+        ob_rr_theme->button_size)
+    {
+        if (fx < (self->bwidth + ob_rr_theme->paddingx + 1 +
+                  ob_rr_theme->button_size))
+        {
+            if (self->leftmost != OB_FRAME_CONTEXT_NONE)
+                return self->leftmost;
+        }
+        else if (fx >= (self->area.width -
+                        (self->bwidth + ob_rr_theme->paddingx + 1 +
+                         ob_rr_theme->button_size)))
+        {
+            if (self->rightmost != OB_FRAME_CONTEXT_NONE)
+                return self->rightmost;
+        }
+    }
+
+    /* there is no resizing maximized windows so make them the titlebar
+       context */
+    return OB_FRAME_CONTEXT_TITLEBAR;
+}
+
+/* the element of the titlebar at a position relative to the title, where
+   frame_adjust_area() would put the element windows */
+static ObFrameContext title_context_at(ObFrame *self, gint x, gint y)
+{
+    const gint bs = ob_rr_theme->button_size;
+    const gint by = ob_rr_theme->paddingy + 1;
+
+#define IN_BUTTON(bx) (x >= (bx) && x < (bx) + bs && y >= by && y < by + bs)
+
+    if (self->icon_on &&
+        x >= self->icon_x && x < self->icon_x + bs + 2 &&
+        y >= by - 1 && y < by + bs + 1)
+        return OB_FRAME_CONTEXT_ICON;
+    if (self->desk_on && IN_BUTTON(self->desk_x))
+        return OB_FRAME_CONTEXT_ALLDESKTOPS;
+    if (self->shade_on && IN_BUTTON(self->shade_x))
+        return OB_FRAME_CONTEXT_SHADE;
+    if (self->iconify_on && IN_BUTTON(self->iconify_x))
+        return OB_FRAME_CONTEXT_ICONIFY;
+    if (self->max_on && IN_BUTTON(self->max_x))
+        return OB_FRAME_CONTEXT_MAXIMIZE;
+    if (self->close_on && IN_BUTTON(self->close_x))
+        return OB_FRAME_CONTEXT_CLOSE;
+
+#undef IN_BUTTON
+
+    if (self->label_on &&
+        x >= self->label_x && x < self->label_x + self->label_width &&
+        y >= by - 1 && y < by - 1 + ob_rr_theme->label_height)
+        return OB_FRAME_CONTEXT_TITLEBAR;
+
+    if (self->decorations & OB_FRAME_DECOR_GRIPS) {
+        if (y < by) {
+            if (x < ob_rr_theme->grip_width)
+                return OB_FRAME_CONTEXT_TLCORNER;
+            if (x >= self->width - ob_rr_theme->grip_width)
+                return OB_FRAME_CONTEXT_TRCORNER;
+            return OB_FRAME_CONTEXT_TOP;
+        }
+        if (x < ob_rr_theme->paddingx + 1)
+            return OB_FRAME_CONTEXT_TLCORNER;
+        if (x >= self->width - (ob_rr_theme->paddingx + 1))
+            return OB_FRAME_CONTEXT_TRCORNER;
+    }
+    return OB_FRAME_CONTEXT_TITLEBAR;
+}
+
+/* the element of a single-window decoration at a position relative to the
+   whole frame, where frame_adjust_area() would put the element windows */
+static ObFrameContext context_at(ObFrame *self, gint x, gint y)
+{
+    const gint bw = self->bwidth;
+    const gint gw = ob_rr_theme->grip_width;
+    const gint sidebw = self->max_horz ? 0 : bw;
+    const gint w = self->client->area.width +
+        self->size.left + self->size.right;
+    const gint h = self->client->area.height +
+        self->size.top + self->size.bottom;
+    const gint th = ob_rr_theme->title_height;
+
+    /* the outside border */
+    if (y < bw) {
+        if (x < gw + bw)                return OB_FRAME_CONTEXT_TLCORNER;
+        if (x >= w - (gw + bw))         return OB_FRAME_CONTEXT_TRCORNER;
+        return OB_FRAME_CONTEXT_TOP;
+    }
+    if (x < sidebw) {
+        if (y < bw + gw)                return OB_FRAME_CONTEXT_TLCORNER;
+        if (y >= h - gw)                return OB_FRAME_CONTEXT_BLCORNER;
+        return OB_FRAME_CONTEXT_LEFT;
+    }
+    if (x >= w - sidebw) {
+        if (y < bw + gw)                return OB_FRAME_CONTEXT_TRCORNER;
+        if (y >= h - gw)                return OB_FRAME_CONTEXT_BRCORNER;
+        return OB_FRAME_CONTEXT_RIGHT;
+    }
+    if (self->size.bottom && y >= h - bw) {
+        if (x < sidebw + gw + bw)       return OB_FRAME_CONTEXT_BLCORNER;
+        if (x >= w - (sidebw + gw + bw)) return OB_FRAME_CONTEXT_BRCORNER;
+        return OB_FRAME_CONTEXT_BOTTOM;
+    }
+
+    if (self->decorations & OB_FRAME_DECOR_TITLEBAR) {
+        if (y < bw + th)
+            return title_context_at(self, x - sidebw, y - bw);
+        if (y < bw * 2 + th || self->shaded)
+            return OB_FRAME_CONTEXT_TITLEBAR;
+    }
+
+    if (self->decorations & OB_FRAME_DECOR_HANDLE &&
+        ob_rr_theme->handle_height > 0 &&
+        y >= FRAME_HANDLE_Y(self) &&
+        y < FRAME_HANDLE_Y(self) + bw + ob_rr_theme->handle_height)
+    {
+        if (self->decorations & OB_FRAME_DECOR_GRIPS) {
+            if (x < sidebw + gw + bw)   return OB_FRAME_CONTEXT_BLCORNER;
+            if (x >= w - (sidebw + gw + bw))
+                return OB_FRAME_CONTEXT_BRCORNER;
+        }
+        return OB_FRAME_CONTEXT_BOTTOM;
+    }
+
+    /* the inner client border */
+    if (y < self->size.top)
+        return OB_FRAME_CONTEXT_TITLEBAR;
+    if (y >= self->size.top + self->client->area.height) {
+        if (x < self->size.left - self->cbwidth_l + gw + bw)
+            return OB_FRAME_CONTEXT_BLCORNER;
+        if (x >= self->size.left + self->client->area.width +
+            self->cbwidth_r - (gw + bw))
+            return OB_FRAME_CONTEXT_BRCORNER;
+        return OB_FRAME_CONTEXT_BOTTOM;
+    }
+    if (x < self->size.left || x >= self->size.left + self->client->area.width)
+    {
+        const gboolean left = x < self->size.left;
+
+        if (y >= self->size.top + self->client->area.height -
+            (gw - self->size.bottom))
+            return left ? OB_FRAME_CONTEXT_BLCORNER : OB_FRAME_CONTEXT_BRCORNER;
+        return left ? OB_FRAME_CONTEXT_LEFT : OB_FRAME_CONTEXT_RIGHT;
+    }
+
+    /* under the client */
+    return OB_FRAME_CONTEXT_NONE;
+}
+
+static ObCursor context_cursor(ObFrame *self, ObFrameContext con)
+{
+    const gboolean sh = self->client->shaded;
+
+    if (!(self->client->functions & OB_CLIENT_FUNC_RESIZE) ||
+        (self->client->max_horz && self->client->max_vert))
+        return OB_CURSOR_NONE;
+
+    switch (con) {
+    case OB_FRAME_CONTEXT_TOP:
+        return !self->client->max_vert && !sh ?
+            OB_CURSOR_NORTH : OB_CURSOR_NONE;
+    case OB_FRAME_CONTEXT_BOTTOM:
+        return !self->client->max_vert ? OB_CURSOR_SOUTH : OB_CURSOR_NONE;
+    case OB_FRAME_CONTEXT_TLCORNER:
+        return sh ? OB_CURSOR_WEST : OB_CURSOR_NORTHWEST;
+    case OB_FRAME_CONTEXT_TRCORNER:
+        return sh ? OB_CURSOR_EAST : OB_CURSOR_NORTHEAST;
+    case OB_FRAME_CONTEXT_LEFT:
+        return OB_CURSOR_WEST;
+    case OB_FRAME_CONTEXT_RIGHT:
+        return OB_CURSOR_EAST;
+    case OB_FRAME_CONTEXT_BLCORNER:
+        return OB_CURSOR_SOUTHWEST;
+    case OB_FRAME_CONTEXT_BRCORNER:
+        return OB_CURSOR_SOUTHEAST;
+    default:
+        return OB_CURSOR_NONE;
+    }
+}
+
+void frame_set_pointer_context(ObFrame *self, ObFrameContext con)
+{
+    if (!self->single || self->decor_context == con) return;
+
+    self->decor_context = con;
+    XDefineCursor(obt_display, self->decor,
+                  ob_cursor(context_cursor(self, con)));
+}
+
 ObFrameContext frame_context(ObClient *client, Window win, gint x, gint y)
 {
     ObFrame *self;
@@ -1416,6 +1810,22 @@ ObFrameContext frame_context(ObClient *client, Window win, gint x, gint y)
 
     self = client->frame;
 
+    if (self->single && win == self->decor) {
+        ObFrameContext con;
+
+        /* the decor window covers the whole frame, so x and y are already
+           relative to the frame */
+        if (self->max_horz && self->max_vert &&
+            y < self->bwidth + ob_rr_theme->title_height)
+            return maxed_title_context(self, x, y);
+
+        con = context_at(self, x, y);
+        /* can't resize vertically when max vert or shaded */
+        if (con == OB_FRAME_CONTEXT_TOP && (self->max_vert || self->shaded))
+            return OB_FRAME_CONTEXT_TITLEBAR;
+        return con;
+    }
+
     /* when the user clicks in the corners of the titlebar and the client
        is fully maximized, then treat it like they clicked in the
        button that is there */
@@ -1446,29 +1856,7 @@ ObFrameContext frame_context(ObClient *client, Window win, gint x, gint y)
         else if (win == self->titleright)
             fx += self->area.width - self->bwidth;
 
-        /* figure out if we're over the area that should be considered a
-           button */
-        if (fy < self->bwidth + ob_rr_theme->paddingy + 1 +
-            ob_rr_theme->button_size)
-        {
-            if (fx < (self->bwidth + ob_rr_theme->paddingx + 1 +
-                      ob_rr_theme->button_size))
-            {
-                if (self->leftmost != OB_FRAME_CONTEXT_NONE)
-                    return self->leftmost;
-            }
-            else if (fx >= (self->area.width -
-                            (self->bwidth + ob_rr_theme->paddingx + 1 +
-                             ob_rr_theme->button_size)))
-            {
-                if (self->rightmost != OB_FRAME_CONTEXT_NONE)
-                    return self->rightmost;
-            }
-        }
-
-        /* there is no resizing maximized windows so make them the titlebar
-           context */
-        return OB_FRAME_CONTEXT_TITLEBAR;
+        return maxed_title_context(self, fx, fy);
     }
     else if (self->max_vert &&
              (win == self->titletop || win == self->topresize))
@@ -1667,14 +2055,11 @@ static void flash_done(gpointer data)
     self->flash_timer = 0;
 }
 
-static gboolean flash_timeout(gpointer data)
+static gboolean flash_step(gdouble progress, gpointer data)
 {
     ObFrame *self = data;
-    GDateTime *now = g_date_time_new_now_local();
 
-    gint compare =  g_date_time_compare(now, self->flash_end);
-    g_date_time_unref(now);
-    if (compare == 1)
+    if (g_get_monotonic_time() > self->flash_end)
         self->flashing = FALSE;
 
     if (!self->flashing) {
@@ -1689,7 +2074,7 @@ static gboolean flash_timeout(gpointer data)
         frame_adjust_focus(self, self->flash_on);
         self->focused = FALSE;
     }
-    
+
     return TRUE; /* go again */
 }
 
@@ -1698,16 +2083,10 @@ void frame_flash_start(ObFrame *self)
     self->flash_on = self->focused;
 
     if (!self->flashing)
-        self->flash_timer = g_timeout_add_full(G_PRIORITY_DEFAULT,
-                                               600, flash_timeout, self,
-                                               flash_done);
-    GDateTime *now = g_date_time_new_now_local();
-    self->flash_end = now;
-    g_date_time_unref(now);
-    
-    GDateTime *tmp = g_date_time_add(self->flash_end, (G_USEC_PER_SEC * 5) );
-    self->flash_end = tmp;
-    g_date_time_unref(tmp);
+        self->flash_timer = animation_add(0, FRAME_FLASH_STEP_TIME,
+                                          OB_ANIMATION_EASE_LINEAR,
+                                          flash_step, self, flash_done);
+    self->flash_end = g_get_monotonic_time() + FRAME_FLASH_TIME;
 
     self->flashing = TRUE;
 }
@@ -1717,23 +2096,11 @@ void frame_flash_stop(ObFrame *self)
     self->flashing = FALSE;
 }
 
-static GTimeSpan frame_animate_iconify_time_left(ObFrame *self)
-{
-    GDateTime *now = g_date_time_new_now_local ();
-    glong sec, usec;
-    GTimeSpan time_left = g_date_time_difference (now,self->iconify_animation_end);
-    g_date_time_unref(now);
-    
-    return time_left;
-}
-
-static gboolean frame_animate_iconify(gpointer p)
+static gboolean frame_animate_iconify(gdouble progress, gpointer p)
 {
     ObFrame *self = p;
     gint x, y, w, h;
     gint iconx, icony, iconw;
-    GTimeSpan time;
-    gboolean iconifying;
 
     if (self->client->icon_geometry.width == 0) {
         /* there is no icon geometry set so just go straight down */
@@ -1749,45 +2116,28 @@ static gboolean frame_animate_iconify(gpointer p)
         iconw = self->client->icon_geometry.width;
     }
 
-    iconifying = self->iconify_animation_going > 0;
+    /* progress goes from the frame to the icon. if restoring, we move in the
+       opposite direction */
+    if (self->iconify_animation_going < 0)
+        progress = 1.0 - progress;
 
-    time = frame_animate_iconify_time_left(self);
+    x = self->area.x + (iconx - self->area.x) * progress;
+    y = self->area.y + (icony - self->area.y) * progress;
+    w = self->area.width -
+        (self->area.width - self->bwidth * 2 - iconw) * progress;
+    h = self->size.top; /* just the titlebar */
 
-    if ((time > 0 && iconifying) || (time == 0 && !iconifying)) {
-        /* start where the frame is supposed to be */
-        x = self->area.x;
-        y = self->area.y;
-        w = self->area.width;
-        h = self->area.height;
-    } else {
-        /* start at the icon */
-        x = iconx;
-        y = icony;
-        w = iconw;
-        h = self->size.top; /* just the titlebar */
-    }
+    XMoveResizeWindow(obt_display, self->window, x, y, MAX(w, 1), MAX(h, 1));
 
-    if (time > 0) {
-        glong dx, dy, dw;
-        glong elapsed;
-
-        dx = self->area.x - iconx;
-        dy = self->area.y - icony;
-        dw = self->area.width - self->bwidth * 2 - iconw;
-         /* if restoring, we move in the opposite direction */
-        if (!iconifying) { dx = -dx; dy = -dy; dw = -dw; }
-
-        elapsed = FRAME_ANIMATE_ICONIFY_TIME - time;
-        x = x - (dx * elapsed) / FRAME_ANIMATE_ICONIFY_TIME;
-        y = y - (dy * elapsed) / FRAME_ANIMATE_ICONIFY_TIME;
-        w = w - (dw * elapsed) / FRAME_ANIMATE_ICONIFY_TIME;
-        h = self->size.top; /* just the titlebar */
-    }
+    return TRUE; /* repeat until we're out of time */
+}
 
-    XMoveResizeWindow(obt_display, self->window, x, y, w, h);
-    XFlush(obt_display);
-    
-    return time > 0; /* repeat until we're out of time */
+static void frame_iconify_animation_done(gpointer data)
+{
+    ObFrame *self = data;
+
+    self->iconify_animation_timer = 0;
+    frame_end_iconify_animation(self);
 }
 
 void frame_end_iconify_animation(gpointer data)
@@ -1796,6 +2146,14 @@ void frame_end_iconify_animation(gpointer data)
     /* see if there is an animation going */
     if (self->iconify_animation_going == 0) return;
 
+    if (self->iconify_animation_timer) {
+        guint id = self->iconify_animation_timer;
+
+        self->iconify_animation_timer = 0;
+        /* removing the animation calls back here to finish up */
+        if (animation_remove(id)) return;
+    }
+
     if (!self->visible)
         XUnmapWindow(obt_display, self->window);
     else {
@@ -1809,7 +2167,6 @@ void frame_end_iconify_animation(gpointer data)
 
     /* we're not animating any more ! */
     self->iconify_animation_going = 0;
-    self->iconify_animation_timer = 0;
 
     XMoveResizeWindow(obt_display, self->window,
                       self->area.x, self->area.y,
@@ -1821,50 +2178,34 @@ void frame_end_iconify_animation(gpointer data)
 
 void frame_begin_iconify_animation(ObFrame *self, gboolean iconifying)
 {
-    GTimeSpan time;
-    gboolean new_anim = FALSE;
-    gboolean set_end = TRUE;
-
     /* if there is no titlebar, just don't animate for now
        XXX it would be nice tho.. */
     if (!(self->decorations & OB_FRAME_DECOR_TITLEBAR))
         return;
 
-    /* get how long until the end */
-    time = FRAME_ANIMATE_ICONIFY_TIME;
     if (self->iconify_animation_going) {
         if (!!iconifying != (self->iconify_animation_going > 0)) {
-            /* animation was already going on in the opposite direction */
-            time = time - frame_animate_iconify_time_left(self);
-        } else
-            /* animation was already going in the same direction */
-            set_end = FALSE;
-    } else
-        new_anim = TRUE;
-    self->iconify_animation_going = iconifying ? 1 : -1;
-
-    /* set the ending time */
-    if (set_end) {
-        if(self->iconify_animation_end) 
-            g_date_time_unref(self->iconify_animation_end);
-        
-        GDateTime *now = g_date_time_new_now_local();
-        self->iconify_animation_end = g_date_time_add(now, time);
-        g_date_time_unref(now);
-    }
-    
-    if (new_anim) {
-        if (self->iconify_animation_timer)
-            g_source_remove(self->iconify_animation_timer);
+            /* animation was already going on in the opposite direction, so
+               turn around from where it is now */
+            gdouble done;
+
+            done = animation_get_progress(self->iconify_animation_timer);
+            animation_set_progress(self->iconify_animation_timer, 1.0 - done);
+        }
+        /* else animation was already going in the same direction */
+        self->iconify_animation_going = iconifying ? 1 : -1;
+    } else {
+        self->iconify_animation_going = iconifying ? 1 : -1;
+        /* the in-out curve is symmetric, so turning around part way through
+           keeps the frame where it is */
         self->iconify_animation_timer =
-            g_timeout_add_full(G_PRIORITY_DEFAULT,
-                               FRAME_ANIMATE_ICONIFY_STEP_TIME,
-                               frame_animate_iconify, self,
-                               frame_end_iconify_animation);
-                               
+            animation_add(FRAME_ANIMATE_ICONIFY_TIME, 0,
+                          OB_ANIMATION_EASE_IN_OUT,
+                          frame_animate_iconify, self,
+                          frame_iconify_animation_done);
 
         /* do the first step */
-        frame_animate_iconify(self);
+        frame_animate_iconify(0.0, self);
 
         /* show it during the animation even if it is not "visible" */
         if (!self->visible)
@@ -79,6 +79,27 @@ typedef enum {
     OB_FRAME_DECOR_CLOSE       = 1 << 9  /*!< Display a close button */
 } ObFrameDecorations;
 
+/*! The parts of the frame which need to be painted again */
+typedef enum {
+    OB_FRAME_DAMAGE_BORDER   = 1 << 0, /*!< The borders around the frame */
+    /*! The titlebar, and everything drawn on top of it */
+    OB_FRAME_DAMAGE_TITLE    = 1 << 1,
+    OB_FRAME_DAMAGE_LABEL    = 1 << 2, /*!< The window's title */
+    OB_FRAME_DAMAGE_ICON     = 1 << 3, /*!< The window's icon */
+    OB_FRAME_DAMAGE_MAX      = 1 << 4, /*!< The maximize button */
+    OB_FRAME_DAMAGE_CLOSE    = 1 << 5, /*!< The close button */
+    OB_FRAME_DAMAGE_DESK     = 1 << 6, /*!< The all-desktops button */
+    OB_FRAME_DAMAGE_SHADE    = 1 << 7, /*!< The shade button */
+    OB_FRAME_DAMAGE_ICONIFY  = 1 << 8, /*!< The iconify button */
+    OB_FRAME_DAMAGE_HANDLE   = 1 << 9, /*!< The handle and its grips */
+    OB_FRAME_DAMAGE_BUTTONS  = (OB_FRAME_DAMAGE_MAX |
+                                OB_FRAME_DAMAGE_CLOSE |
+                                OB_FRAME_DAMAGE_DESK |
+                                OB_FRAME_DAMAGE_SHADE |
+                                OB_FRAME_DAMAGE_ICONIFY),
+    OB_FRAME_DAMAGE_ALL      = (1 << 10) - 1
+} ObFrameDamage;
+
 struct _ObFrame
 {
     struct _ObClient *client;
@@ -143,6 +164,21 @@ struct _ObFrame
     Window    trtresize;
     Window    trrresize;
 
+    /*! The decoration windows are only created when the frame is first
+      shown. Until then only the frame window, backback and backfront exist,
+      though the frame's geometry is kept up to date */
+    gboolean  realized;
+    /*! Set when the whole decoration is painted onto the single decor window.
+      None of the element windows above exist then, and frame_context() finds
+      the element under the pointer from the frame's geometry instead */
+    gboolean  single;
+    Window    decor;
+    Pixmap    decor_pixmap; /*!< The decoration, painted as decor's background */
+    gint      decor_w;
+    gint      decor_h;
+    /*! The element the cursor on the decor window was last chosen for */
+    ObFrameContext decor_context;
+
     Colormap  colormap;
 
     gint      icon_on;    /* if the window icon button is on */
@@ -187,20 +223,20 @@ struct _ObFrame
     gboolean  iconify_hover;
 
     gboolean  focused;
-    gboolean  need_render;
+    guint     damage; /*!< The ObFrameDamage parts to paint on next render */
 
     gboolean  flashing;
     gboolean  flash_on;
-    GDateTime  *flash_end;
-    guint     flash_timer;
+    gint64    flash_end;   /*!< Monotonic time at which to stop flashing */
+    guint     flash_timer; /*!< The animation which flashes the frame */
 
     /*! Is the frame currently in an animation for iconify or restore.
       0 means that it is not animating. > 0 means it is animating an iconify.
       < 0 means it is animating a restore.
     */
     gint iconify_animation_going;
+    /*! The animation moving the frame for an iconify or restore */
     guint iconify_animation_timer;
-    GDateTime  *iconify_animation_end;
 };
 
 ObFrame *frame_new(struct _ObClient *c);
@@ -208,6 +244,11 @@ void frame_free(ObFrame *self);
 
 void frame_show(ObFrame *self);
 void frame_hide(ObFrame *self);
+/*! Shows all the frames in the list, mapping them in the list's order while
+  holding a single server grab */
+void frame_show_batch(GSList *frames);
+/*! Hides all the frames in the list, unmapping them in the list's order */
+void frame_hide_batch(GSList *frames);
 void frame_adjust_theme(ObFrame *self);
 #ifdef SHAPE
 void frame_adjust_shape_kind(ObFrame *self, int kind);
@@ -220,6 +261,9 @@ void frame_adjust_state(ObFrame *self);
 void frame_adjust_focus(ObFrame *self, gboolean hilite);
 void frame_adjust_title(ObFrame *self);
 void frame_adjust_icon(ObFrame *self);
+/*! Paint a titlebar button again after its hover or pressed state changed.
+  OB_FRAME_CONTEXT_NONE paints all of the buttons. */
+void frame_adjust_button(ObFrame *self, ObFrameContext con);
 void frame_grab_client(ObFrame *self);
 void frame_release_client(ObFrame *self);
 
@@ -235,6 +279,9 @@ ObFrameContext frame_context_from_string(const gchar *name);
 */
 gboolean frame_next_context_from_string(gchar *names, ObFrameContext *cx);
 
+/*! Use the cursor for the given element on a single-window decoration */
+void frame_set_pointer_context(ObFrame *self, ObFrameContext con);
+
 ObFrameContext frame_context(struct _ObClient *self, Window win,
                              gint x, gint y);
 
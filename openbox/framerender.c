@@ -31,18 +31,74 @@ static void framerender_iconify(ObFrame *self, RrAppearance *a);
 static void framerender_desk(ObFrame *self, RrAppearance *a);
 static void framerender_shade(ObFrame *self, RrAppearance *a);
 static void framerender_close(ObFrame *self, RrAppearance *a);
+static gboolean framerender_decor_borders(ObFrame *self, guint damage);
+
+/*! When this is set, painting only collects the appearances to render them
+  all ahead of time, and nothing is drawn */
+static RrPrerender *prerender = NULL;
+
+void framerender_prerender(RrPrerender *p)
+{
+    prerender = p;
+}
+
+/*! Paint an element of the frame onto its window, or in single-window mode,
+  into the decoration's pixmap at the element's position in the frame */
+static void paint(ObFrame *self, RrAppearance *a, Window win,
+                  gint x, gint y, gint w, gint h)
+{
+    Pixmap oldp;
+
+    if (prerender) {
+        RrPrerenderAdd(prerender, a, w, h);
+        return;
+    }
+
+    if (!self->single) {
+        RrPaint(a, win, w, h);
+        return;
+    }
+
+    if (w <= 0 || h <= 0) return;
+
+    oldp = RrPaintPixmap(a, w, h);
+    /* any GC with the right depth will do for copying */
+    if (a->pixmap)
+        XCopyArea(obt_display, a->pixmap, self->decor_pixmap,
+                  RrColorGC(ob_rr_theme->frame_focused_border_color),
+                  0, 0, w, h, x, y);
+    if (oldp) XFreePixmap(obt_display, oldp);
+}
+
+/* the position of the title and handle inside the frame */
+#define TITLE_X(f) ((f)->max_horz ? 0 : (f)->bwidth)
+#define TITLE_Y(f) ((f)->bwidth)
+#define HANDLE_Y(f) ((f)->size.top + (f)->client->area.height + \
+                     (f)->cbwidth_b + (f)->bwidth)
 
 void framerender_frame(ObFrame *self)
 {
+    guint damage;
+
     if (frame_iconify_animating(self))
         return; /* delay redrawing until the animation is done */
-    if (!self->need_render)
+    if (!self->damage)
         return;
     if (!self->visible)
         return;
-    self->need_render = FALSE;
-
-    {
+    damage = self->damage;
+    /* when prerendering, nothing is drawn yet, so keep the damage for when
+       the frame is painted */
+    if (!prerender)
+        self->damage = 0;
+
+    if (!prerender && self->single) {
+        /* when the pixmap gets filled in again everything on top of it has
+           to be drawn again too */
+        if (framerender_decor_borders(self, damage))
+            damage = OB_FRAME_DAMAGE_ALL;
+    }
+    else if (!prerender && damage & OB_FRAME_DAMAGE_BORDER) {
         gulong px;
 
         px = (self->focused ?
@@ -125,7 +181,15 @@ void framerender_frame(ObFrame *self)
         XClearWindow(obt_display, self->titlebottom);
     }
 
-    if (self->decorations & OB_FRAME_DECOR_TITLEBAR) {
+    /* the label, icon and buttons are drawn on top of the titlebar */
+    if (damage & OB_FRAME_DAMAGE_TITLE)
+        damage |= OB_FRAME_DAMAGE_LABEL | OB_FRAME_DAMAGE_ICON |
+            OB_FRAME_DAMAGE_BUTTONS;
+
+    if (self->decorations & OB_FRAME_DECOR_TITLEBAR &&
+        damage & (OB_FRAME_DAMAGE_TITLE | OB_FRAME_DAMAGE_LABEL |
+                  OB_FRAME_DAMAGE_ICON | OB_FRAME_DAMAGE_BUTTONS))
+    {
         RrAppearance *t, *l, *m, *n, *i, *d, *s, *c, *clear;
         if (self->focused) {
             t = ob_rr_theme->a_focused_title;
@@ -244,37 +308,55 @@ void framerender_frame(ObFrame *self)
         }
         clear = ob_rr_theme->a_clear;
 
-        RrPaint(t, self->title, self->width, ob_rr_theme->title_height);
+        if (damage & OB_FRAME_DAMAGE_TITLE)
+            paint(self, t, self->title, TITLE_X(self), TITLE_Y(self),
+                  self->width, ob_rr_theme->title_height);
+        else if (!prerender && (t->w != self->width ||
+                                t->h != ob_rr_theme->title_height))
+        {
+            Pixmap oldp;
+
+            /* the titlebar's appearance is shared by all the frames, so it
+               may have last been drawn at another frame's size.  parent
+               relative elements copy from it, so draw it again at this
+               frame's size without touching the title window */
+            oldp = RrPaintPixmap(t, self->width, ob_rr_theme->title_height);
+            if (oldp) XFreePixmap(obt_display, oldp);
+        }
 
-        clear->surface.parent = t;
-        clear->surface.parenty = 0;
+        /* the resize areas in the titlebar are only windows to paint when
+           there is a window for each element */
+        if (!self->single && !prerender && damage & OB_FRAME_DAMAGE_TITLE) {
+            clear->surface.parent = t;
+            clear->surface.parenty = 0;
 
-        clear->surface.parentx = ob_rr_theme->grip_width;
+            clear->surface.parentx = ob_rr_theme->grip_width;
 
-        RrPaint(clear, self->topresize,
-                self->width - ob_rr_theme->grip_width * 2,
-                ob_rr_theme->paddingy + 1);
+            RrPaint(clear, self->topresize,
+                    self->width - ob_rr_theme->grip_width * 2,
+                    ob_rr_theme->paddingy + 1);
 
-        clear->surface.parentx = 0;
+            clear->surface.parentx = 0;
 
-        if (ob_rr_theme->grip_width > 0)
-            RrPaint(clear, self->tltresize,
-                    ob_rr_theme->grip_width, ob_rr_theme->paddingy + 1);
-        if (ob_rr_theme->title_height > 0)
-            RrPaint(clear, self->tllresize,
-                    ob_rr_theme->paddingx + 1, ob_rr_theme->title_height);
+            if (ob_rr_theme->grip_width > 0)
+                RrPaint(clear, self->tltresize,
+                        ob_rr_theme->grip_width, ob_rr_theme->paddingy + 1);
+            if (ob_rr_theme->title_height > 0)
+                RrPaint(clear, self->tllresize,
+                        ob_rr_theme->paddingx + 1, ob_rr_theme->title_height);
 
-        clear->surface.parentx = self->width - ob_rr_theme->grip_width;
+            clear->surface.parentx = self->width - ob_rr_theme->grip_width;
 
-        if (ob_rr_theme->grip_width > 0)
-            RrPaint(clear, self->trtresize,
-                    ob_rr_theme->grip_width, ob_rr_theme->paddingy + 1);
+            if (ob_rr_theme->grip_width > 0)
+                RrPaint(clear, self->trtresize,
+                        ob_rr_theme->grip_width, ob_rr_theme->paddingy + 1);
 
-        clear->surface.parentx = self->width - (ob_rr_theme->paddingx + 1);
+            clear->surface.parentx = self->width - (ob_rr_theme->paddingx + 1);
 
-        if (ob_rr_theme->title_height > 0)
-            RrPaint(clear, self->trrresize,
-                    ob_rr_theme->paddingx + 1, ob_rr_theme->title_height);
+            if (ob_rr_theme->title_height > 0)
+                RrPaint(clear, self->trrresize,
+                        ob_rr_theme->paddingx + 1, ob_rr_theme->title_height);
+        }
 
         /* set parents for any parent relative guys */
         l->surface.parent = t;
@@ -305,24 +387,32 @@ void framerender_frame(ObFrame *self)
         c->surface.parentx = self->close_x;
         c->surface.parenty = ob_rr_theme->paddingy + 1;
 
-        framerender_label(self, l);
-        framerender_max(self, m);
-        framerender_icon(self, n);
-        framerender_iconify(self, i);
-        framerender_desk(self, d);
-        framerender_shade(self, s);
-        framerender_close(self, c);
+        if (damage & OB_FRAME_DAMAGE_LABEL)
+            framerender_label(self, l);
+        if (damage & OB_FRAME_DAMAGE_MAX)
+            framerender_max(self, m);
+        if (damage & OB_FRAME_DAMAGE_ICON)
+            framerender_icon(self, n);
+        if (damage & OB_FRAME_DAMAGE_ICONIFY)
+            framerender_iconify(self, i);
+        if (damage & OB_FRAME_DAMAGE_DESK)
+            framerender_desk(self, d);
+        if (damage & OB_FRAME_DAMAGE_SHADE)
+            framerender_shade(self, s);
+        if (damage & OB_FRAME_DAMAGE_CLOSE)
+            framerender_close(self, c);
     }
 
     if (self->decorations & OB_FRAME_DECOR_HANDLE &&
-        ob_rr_theme->handle_height > 0)
+        ob_rr_theme->handle_height > 0 && damage & OB_FRAME_DAMAGE_HANDLE)
     {
         RrAppearance *h, *g;
 
         h = (self->focused ?
              ob_rr_theme->a_focused_handle : ob_rr_theme->a_unfocused_handle);
 
-        RrPaint(h, self->handle, self->width, ob_rr_theme->handle_height);
+        paint(self, h, self->handle, TITLE_X(self), HANDLE_Y(self),
+              self->width, ob_rr_theme->handle_height);
 
         if (self->decorations & OB_FRAME_DECOR_GRIPS) {
             g = (self->focused ?
@@ -334,26 +424,103 @@ void framerender_frame(ObFrame *self)
             g->surface.parentx = 0;
             g->surface.parenty = 0;
 
-            RrPaint(g, self->lgrip,
-                    ob_rr_theme->grip_width, ob_rr_theme->handle_height);
+            paint(self, g, self->lgrip, TITLE_X(self), HANDLE_Y(self),
+                  ob_rr_theme->grip_width, ob_rr_theme->handle_height);
 
             g->surface.parentx = self->width - ob_rr_theme->grip_width;
             g->surface.parenty = 0;
 
-            RrPaint(g, self->rgrip,
-                    ob_rr_theme->grip_width, ob_rr_theme->handle_height);
+            paint(self, g, self->rgrip,
+                  TITLE_X(self) + self->width - ob_rr_theme->grip_width,
+                  HANDLE_Y(self),
+                  ob_rr_theme->grip_width, ob_rr_theme->handle_height);
         }
     }
 
+    if (prerender)
+        return;
+
+    if (self->single) {
+        /* the server keeps using the pixmap, so setting it again makes it
+           notice the changes */
+        XSetWindowBackgroundPixmap(obt_display, self->decor,
+                                   self->decor_pixmap);
+        XClearWindow(obt_display, self->decor);
+    }
+
     XFlush(obt_display);
 }
 
+/*! Make sure the decoration pixmap fits the frame, and fill in the borders
+  which are given their own windows otherwise.  Returns TRUE if the pixmap
+  was filled in, covering anything drawn on it before */
+static gboolean framerender_decor_borders(ObFrame *self, guint damage)
+{
+    const gint w = self->client->area.width +
+        self->size.left + self->size.right;
+    const gint h = self->client->area.height +
+        self->size.top + self->size.bottom;
+    RrColor *c;
+
+    if (!self->decor_pixmap || self->decor_w != w || self->decor_h != h) {
+        if (self->decor_pixmap)
+            XFreePixmap(obt_display, self->decor_pixmap);
+        self->decor_pixmap = XCreatePixmap(obt_display, obt_root(ob_screen),
+                                           MAX(w, 1), MAX(h, 1),
+                                           RrDepth(ob_rr_inst));
+        self->decor_w = w;
+        self->decor_h = h;
+    }
+    else if (!(damage & OB_FRAME_DAMAGE_BORDER))
+        return FALSE;
+
+    c = (self->focused ?
+         (self->client->undecorated ?
+          ob_rr_theme->frame_undecorated_focused_border_color :
+          ob_rr_theme->frame_focused_border_color) :
+         (self->client->undecorated ?
+          ob_rr_theme->frame_undecorated_unfocused_border_color :
+          ob_rr_theme->frame_unfocused_border_color));
+    XFillRectangle(obt_display, self->decor_pixmap, RrColorGC(c),
+                   0, 0, w, h);
+
+    /* the inner client border, and the window shown behind the client while
+       resizing */
+    c = (self->focused ?
+         ob_rr_theme->cb_focused_color : ob_rr_theme->cb_unfocused_color);
+    XFillRectangle(obt_display, self->decor_pixmap, RrColorGC(c),
+                   self->size.left - self->cbwidth_l,
+                   self->size.top - self->cbwidth_t,
+                   self->client->area.width +
+                   self->cbwidth_l + self->cbwidth_r,
+                   self->client->area.height +
+                   self->cbwidth_t + self->cbwidth_b);
+    XSetWindowBackground(obt_display, self->backback, RrColorPixel(c));
+    XClearWindow(obt_display, self->backback);
+
+    /* don't use the separator color for shaded windows */
+    if (self->decorations & OB_FRAME_DECOR_TITLEBAR && self->bwidth &&
+        !self->client->shaded)
+    {
+        c = (self->focused ?
+             ob_rr_theme->title_separator_focused_color :
+             ob_rr_theme->title_separator_unfocused_color);
+        XFillRectangle(obt_display, self->decor_pixmap, RrColorGC(c),
+                       TITLE_X(self),
+                       ob_rr_theme->title_height + self->bwidth,
+                       self->width, self->bwidth);
+    }
+    return TRUE;
+}
+
 static void framerender_label(ObFrame *self, RrAppearance *a)
 {
     if (!self->label_on) return;
     /* set the texture's text! */
     a->texture[0].data.text.string = self->client->title;
-    RrPaint(a, self->label, self->label_width, ob_rr_theme->label_height);
+    paint(self, a, self->label, TITLE_X(self) + self->label_x,
+          TITLE_Y(self) + ob_rr_theme->paddingy,
+          self->label_width, ob_rr_theme->label_height);
 }
 
 static void framerender_icon(ObFrame *self, RrAppearance *a)
@@ -374,39 +541,47 @@ static void framerender_icon(ObFrame *self, RrAppearance *a)
         a->texture[0].type = RR_TEXTURE_NONE;
     }
 
-    RrPaint(a, self->icon,
-            ob_rr_theme->button_size + 2, ob_rr_theme->button_size + 2);
+    paint(self, a, self->icon, TITLE_X(self) + self->icon_x,
+          TITLE_Y(self) + ob_rr_theme->paddingy,
+          ob_rr_theme->button_size + 2, ob_rr_theme->button_size + 2);
 }
 
 static void framerender_max(ObFrame *self, RrAppearance *a)
 {
     if (!self->max_on) return;
-    RrPaint(a, self->max, ob_rr_theme->button_size, ob_rr_theme->button_size);
+    paint(self, a, self->max, TITLE_X(self) + self->max_x,
+          TITLE_Y(self) + ob_rr_theme->paddingy + 1,
+          ob_rr_theme->button_size, ob_rr_theme->button_size);
 }
 
 static void framerender_iconify(ObFrame *self, RrAppearance *a)
 {
     if (!self->iconify_on) return;
-    RrPaint(a, self->iconify,
-            ob_rr_theme->button_size, ob_rr_theme->button_size);
+    paint(self, a, self->iconify, TITLE_X(self) + self->iconify_x,
+          TITLE_Y(self) + ob_rr_theme->paddingy + 1,
+          ob_rr_theme->button_size, ob_rr_theme->button_size);
 }
 
 static void framerender_desk(ObFrame *self, RrAppearance *a)
 {
     if (!self->desk_on) return;
-    RrPaint(a, self->desk, ob_rr_theme->button_size, ob_rr_theme->button_size);
+    paint(self, a, self->desk, TITLE_X(self) + self->desk_x,
+          TITLE_Y(self) + ob_rr_theme->paddingy + 1,
+          ob_rr_theme->button_size, ob_rr_theme->button_size);
 }
 
 static void framerender_shade(ObFrame *self, RrAppearance *a)
 {
     if (!self->shade_on) return;
-    RrPaint(a, self->shade,
-            ob_rr_theme->button_size, ob_rr_theme->button_size);
+    paint(self, a, self->shade, TITLE_X(self) + self->shade_x,
+          TITLE_Y(self) + ob_rr_theme->paddingy + 1,
+          ob_rr_theme->button_size, ob_rr_theme->button_size);
 }
 
 static void framerender_close(ObFrame *self, RrAppearance *a)
 {
     if (!self->close_on) return;
-    RrPaint(a, self->close,
-            ob_rr_theme->button_size, ob_rr_theme->button_size);
+    paint(self, a, self->close, TITLE_X(self) + self->close_x,
+          TITLE_Y(self) + ob_rr_theme->paddingy + 1,
+          ob_rr_theme->button_size, ob_rr_theme->button_size);
 }
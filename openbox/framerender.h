@@ -19,8 +19,15 @@
 #ifndef __framerender_h
 #define __framerender_h
 
+#include "obrender/render.h"
+
 struct _ObFrame;
 
 void framerender_frame(struct _ObFrame *self);
 
+/*! While a prerender is set, framerender_frame only adds the surfaces it
+  would paint to the prerender, and leaves the frames to be painted again once
+  it has been run.  Set it to NULL to paint normally again */
+void framerender_prerender(RrPrerender *p);
+
 #endif
@@ -22,6 +22,7 @@
 #include "event.h"
 #include "screen.h"
 #include "debug.h"
+#include "metrics.h"
 #include "obt/display.h"
 #include "obt/keyboard.h"
 
@@ -133,18 +134,26 @@ gboolean grab_pointer_full(gboolean grab, gboolean owner_events,
     return ret;
 }
 
-gint grab_server(gboolean grab)
+gint grab_server_full(gboolean grab, const gchar *site)
 {
     static guint sgrabs = 0;
+    static gint64 grabbed_at;
+    static const gchar *grabbed_by;
     if (grab) {
         if (sgrabs++ == 0) {
             XGrabServer(obt_display);
             XSync(obt_display, FALSE);
+            obt_display_round_trip();
+            metrics_inc(OB_METRIC_SERVER_GRABS);
+            grabbed_at = g_get_monotonic_time();
+            grabbed_by = site;
         }
     } else if (sgrabs > 0) {
         if (--sgrabs == 0) {
             XUngrabServer(obt_display);
             XFlush(obt_display);
+            metrics_add_grab_time(grabbed_by,
+                                  g_get_monotonic_time() - grabbed_at);
         }
     }
     return sgrabs;
@@ -207,6 +216,27 @@ void ungrab_button(guint button, guint state, Window win)
         XUngrabButton(obt_display, button, state | mask_list[i], win);
 }
 
+void grab_button_list(const ObButtonGrab *grabs, guint n, Window win,
+                      guint mask, gint pointer_mode, ObCursor cur)
+{
+    guint i, j;
+
+    for (j = 0; j < n; ++j)
+        for (i = 0; i < MASK_LIST_SIZE; ++i)
+            XGrabButton(obt_display, grabs[j].button,
+                        grabs[j].state | mask_list[i], win, False,
+                        mask, pointer_mode, GrabModeAsync, None,
+                        ob_cursor(cur));
+}
+
+void ungrab_button_list(const ObButtonGrab *grabs, guint n, Window win)
+{
+    guint j;
+
+    for (j = 0; j < n; ++j)
+        ungrab_button(grabs[j].button, grabs[j].state, win);
+}
+
 void grab_key(guint keycode, guint state, Window win, gint keyboard_mode)
 {
     guint i;
@@ -221,6 +251,14 @@ void grab_key(guint keycode, guint state, Window win, gint keyboard_mode)
         ob_debug("Failed to grab keycode %d modifiers %d", keycode, state);
 }
 
+void ungrab_key(guint keycode, guint state, Window win)
+{
+    guint i;
+
+    for (i = 0; i < MASK_LIST_SIZE; ++i)
+        XUngrabKey(obt_display, keycode, state | mask_list[i], win);
+}
+
 void ungrab_all_keys(Window win)
 {
     XUngrabKey(obt_display, AnyKey, AnyModifier, win);
@@ -34,12 +34,18 @@ gboolean grab_keyboard_full(gboolean grab);
 /*! @param confine If true the pointer is confined to the screen */
 gboolean grab_pointer_full(gboolean grab, gboolean owner_events,
                            gboolean confine, ObCursor cur);
-gint grab_server(gboolean grab);
+/*! Grabs or releases the server.  Grabs nest, and the server is released
+  when every grab has been.  The time the server is held is recorded in the
+  metrics for the site which took the first grab.
+  @return the number of grabs still held
+*/
+gint grab_server_full(gboolean grab, const gchar *site);
 
 #define grab_keyboard() grab_keyboard_full(TRUE)
 #define ungrab_keyboard() grab_keyboard_full(FALSE)
 #define grab_pointer(o,c,u) grab_pointer_full(TRUE, (o), (c), (u))
 #define ungrab_pointer() grab_pointer_full(FALSE, FALSE, FALSE, OB_CURSOR_NONE)
+#define grab_server(g) grab_server_full((g), G_STRLOC)
 
 gboolean grab_on_keyboard(void);
 gboolean grab_on_pointer(void);
@@ -48,7 +54,21 @@ void grab_button_full(guint button, guint state, Window win, guint mask,
                       gint pointer_mode, ObCursor cursor);
 void ungrab_button(guint button, guint state, Window win);
 
+typedef struct _ObButtonGrab {
+    guint button;
+    guint state;
+} ObButtonGrab;
+
+/*! Grabs all of the buttons in the list on the window.  Unlike
+  grab_button_full this does not wait to see if the grabs worked, so it
+  should be called between obt_display_ignore_errors(TRUE) and
+  obt_display_ignore_errors(FALSE), which can cover any number of them. */
+void grab_button_list(const ObButtonGrab *grabs, guint n, Window win,
+                      guint mask, gint pointer_mode, ObCursor cursor);
+void ungrab_button_list(const ObButtonGrab *grabs, guint n, Window win);
+
 void grab_key(guint keycode, guint state, Window win, gint keyboard_mode);
+void ungrab_key(guint keycode, guint state, Window win);
 
 void ungrab_all_keys(Window win);
 
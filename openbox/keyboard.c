@@ -42,25 +42,119 @@ static ObPopup *popup = NULL;
 static KeyBindingTree *curpos;
 static guint chain_timer = 0;
 
-static void grab_keys(gboolean grab)
+/*! Every node in the tree, hashed by its (parent, keycode, modmask) so that
+  a key press is found in its level without walking the siblings */
+static GHashTable *level_index = NULL;
+static gboolean level_index_stale = TRUE;
+/*! The (keycode, modmask) pairs currently grabbed on the root window */
+static GHashTable *grabbed_keys = NULL;
+
+/* keycodes are 8 bits and the modmasks we bind on fit in 16 */
+#define KEY_ID(key, state) GUINT_TO_POINTER(((key) << 16) | ((state) & 0xffff))
+#define KEY_ID_KEY(id) (GPOINTER_TO_UINT(id) >> 16)
+#define KEY_ID_STATE(id) (GPOINTER_TO_UINT(id) & 0xffff)
+
+static guint node_hash(gconstpointer key)
+{
+    const KeyBindingTree *n = key;
+    return g_direct_hash(n->parent) ^ GPOINTER_TO_UINT(KEY_ID(n->key,
+                                                              n->state));
+}
+
+static gboolean node_equal(gconstpointer a, gconstpointer b)
+{
+    const KeyBindingTree *na = a, *nb = b;
+    return na->parent == nb->parent &&
+        na->key == nb->key && na->state == nb->state;
+}
+
+static void index_level(KeyBindingTree *first)
 {
     KeyBindingTree *p;
 
-    ungrab_all_keys(obt_root(ob_screen));
+    for (p = first; p; p = p->next_sibling) {
+        /* skip key bindings that didn't get translated, and let the first
+           sibling win if a level somehow has the same key twice */
+        if (p->key && !g_hash_table_lookup(level_index, p))
+            g_hash_table_insert(level_index, p, p);
+        if (p->first_child)
+            index_level(p->first_child);
+    }
+}
 
-    if (grab) {
-        p = curpos ? curpos->first_child : keyboard_firstnode;
-        while (p) {
-            if (p->key)
-                grab_key(p->key, p->state, obt_root(ob_screen),
-                         GrabModeAsync);
-            p = p->next_sibling;
-        }
-        if (curpos)
-            grab_key(config_keyboard_reset_keycode,
-                     config_keyboard_reset_state,
-                     obt_root(ob_screen), GrabModeAsync);
+static void invalidate_index(void)
+{
+    /* bindings are made while loading the config, before startup */
+    if (level_index)
+        g_hash_table_remove_all(level_index);
+    level_index_stale = TRUE;
+}
+
+/*! Find the binding for a key pressed while at the given level of the tree */
+static KeyBindingTree* find_binding(KeyBindingTree *level,
+                                    guint key, guint state)
+{
+    KeyBindingTree probe;
+
+    if (level_index_stale) {
+        if (!level_index)
+            level_index = g_hash_table_new(node_hash, node_equal);
+        index_level(keyboard_firstnode);
+        level_index_stale = FALSE;
     }
+
+    probe.parent = level;
+    probe.key = key;
+    probe.state = state;
+    return g_hash_table_lookup(level_index, &probe);
+}
+
+/*! Grab the keys needed at the current level, only touching the grabs that
+  differ from the ones already held for the previous level */
+static void grab_level_keys(void)
+{
+    GHashTable *want;
+    GHashTableIter it;
+    gpointer id;
+    KeyBindingTree *p;
+
+    want = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (p = curpos ? curpos->first_child : keyboard_firstnode; p;
+         p = p->next_sibling)
+    {
+        if (p->key)
+            g_hash_table_insert(want, KEY_ID(p->key, p->state), NULL);
+    }
+    if (curpos)
+        g_hash_table_insert(want, KEY_ID(config_keyboard_reset_keycode,
+                                         config_keyboard_reset_state), NULL);
+
+    g_hash_table_iter_init(&it, grabbed_keys);
+    while (g_hash_table_iter_next(&it, &id, NULL))
+        if (!g_hash_table_lookup_extended(want, id, NULL, NULL)) {
+            ungrab_key(KEY_ID_KEY(id), KEY_ID_STATE(id), obt_root(ob_screen));
+            g_hash_table_iter_remove(&it);
+        }
+
+    g_hash_table_iter_init(&it, want);
+    while (g_hash_table_iter_next(&it, &id, NULL))
+        if (!g_hash_table_lookup_extended(grabbed_keys, id, NULL, NULL)) {
+            grab_key(KEY_ID_KEY(id), KEY_ID_STATE(id), obt_root(ob_screen),
+                     GrabModeAsync);
+            g_hash_table_insert(grabbed_keys, id, NULL);
+        }
+
+    g_hash_table_destroy(want);
+}
+
+static void grab_keys(gboolean grab)
+{
+    /* start over from nothing, the keycodes may have changed under us */
+    ungrab_all_keys(obt_root(ob_screen));
+    g_hash_table_remove_all(grabbed_keys);
+
+    if (grab)
+        grab_level_keys();
 }
 
 static gboolean chain_timeout(gpointer data)
@@ -78,9 +172,8 @@ static void set_curpos(KeyBindingTree *newpos)
 {
     if (curpos == newpos) return;
 
-    grab_keys(FALSE);
     curpos = newpos;
-    grab_keys(TRUE);
+    grab_level_keys();
 
     if (curpos != NULL) {
         gchar *text = NULL;
@@ -122,6 +215,7 @@ void keyboard_reset_chains(gint break_chroots)
 
 void keyboard_unbind_all(void)
 {
+    invalidate_index();
     tree_destroy(keyboard_firstnode);
     keyboard_firstnode = NULL;
 }
@@ -136,6 +230,7 @@ void keyboard_chroot(GList *keylist)
             return;
         tree_chroot(tree, keylist);
         tree_assimilate(tree);
+        invalidate_index();
     }
 }
 
@@ -170,7 +265,10 @@ gboolean keyboard_bind(GList *keylist, ObActionsAct *action)
     t->actions = g_slist_append(t->actions, action);
     /* assimilate this built tree into the main tree. assimilation
        destroys/uses the tree */
-    if (tree) tree_assimilate(tree);
+    if (tree) {
+        tree_assimilate(tree);
+        invalidate_index();
+    }
 
     return TRUE;
 }
@@ -238,42 +336,34 @@ gboolean keyboard_event(ObClient *client, const XEvent *e)
     }
 
     used = FALSE;
-    if (curpos == NULL)
-        p = keyboard_firstnode;
-    else
-        p = curpos->first_child;
-    while (p) {
-        if (p->key == e->xkey.keycode && p->state == mods) {
-            /* if we hit a key binding, then close any open menus and run it */
-            if (menu_frame_visible)
-                menu_frame_hide_all();
-
-            if (p->first_child != NULL) { /* part of a chain */
-                if (chain_timer) g_source_remove(chain_timer);
-                /* 3 second timeout for chains */
-                chain_timer =
-                    g_timeout_add_full(G_PRIORITY_DEFAULT,
-                                       3000, chain_timeout, NULL,
-                                       chain_done);
-                set_curpos(p);
-            } else if (p->chroot)         /* an empty chroot */
-                set_curpos(p);
-            else {
-                GSList *it;
-
-                for (it = p->actions; it; it = g_slist_next(it))
-                    if (actions_act_is_interactive(it->data)) break;
-                if (it == NULL) /* reset if the actions are not interactive */
-                    keyboard_reset_chains(0);
-
-                actions_run_acts(p->actions, OB_USER_ACTION_KEYBOARD_KEY,
-                                 e->xkey.state, e->xkey.x_root, e->xkey.y_root,
-                                 0, OB_FRAME_CONTEXT_NONE, client);
-            }
-            used = TRUE;
-            break;
+    if ((p = find_binding(curpos, e->xkey.keycode, mods))) {
+        /* if we hit a key binding, then close any open menus and run it */
+        if (menu_frame_visible)
+            menu_frame_hide_all();
+
+        if (p->first_child != NULL) { /* part of a chain */
+            if (chain_timer) g_source_remove(chain_timer);
+            /* 3 second timeout for chains */
+            chain_timer =
+                g_timeout_add_full(G_PRIORITY_DEFAULT,
+                                   3000, chain_timeout, NULL,
+                                   chain_done);
+            set_curpos(p);
+        } else if (p->chroot)         /* an empty chroot */
+            set_curpos(p);
+        else {
+            GSList *it;
+
+            for (it = p->actions; it; it = g_slist_next(it))
+                if (actions_act_is_interactive(it->data)) break;
+            if (it == NULL) /* reset if the actions are not interactive */
+                keyboard_reset_chains(0);
+
+            actions_run_acts(p->actions, OB_USER_ACTION_KEYBOARD_KEY,
+                             e->xkey.state, e->xkey.x_root, e->xkey.y_root,
+                             0, OB_FRAME_CONTEXT_NONE, client);
         }
-        p = p->next_sibling;
+        used = TRUE;
     }
     return used;
 }
@@ -313,6 +403,7 @@ void keyboard_rebind(void)
 
     old = keyboard_firstnode;
     keyboard_firstnode = NULL;
+    invalidate_index();
     if (old)
         node_rebind(old);
 
@@ -323,6 +414,7 @@ void keyboard_rebind(void)
 
 void keyboard_startup(gboolean reconfig)
 {
+    grabbed_keys = g_hash_table_new(g_direct_hash, g_direct_equal);
     grab_keys(TRUE);
     popup = popup_new();
     popup_set_text_align(popup, RR_JUSTIFY_CENTER);
@@ -335,6 +427,13 @@ void keyboard_shutdown(gboolean reconfig)
     keyboard_unbind_all();
     set_curpos(NULL);
 
+    g_hash_table_destroy(grabbed_keys);
+    grabbed_keys = NULL;
+    if (level_index) {
+        g_hash_table_destroy(level_index);
+        level_index = NULL;
+    }
+
     popup_free(popup);
     popup = NULL;
 }
@@ -0,0 +1,301 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   launcher.c for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "launcher.h"
+#include "debug.h"
+#include "gettext.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef HAVE_SPAWN_H
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#  include <fcntl.h>
+#endif
+
+/* A request to the launcher is its length in bytes, followed by that many
+   bytes: the number of arguments and the number of environment variables,
+   each as a guint32, and then all of the arguments and environment
+   variables, nul terminated.  The launcher replies with a gint32, which is
+   the pid of the new process, or a negative errno value if it could not be
+   started. */
+
+/*! The largest request that will be sent to the launcher */
+#define MAX_REQUEST (1024 * 1024)
+
+#ifndef MSG_NOSIGNAL
+/* not every system has it, and SIGPIPE will end openbox */
+#  define MSG_NOSIGNAL 0
+#endif
+
+/*! The socket to the launcher process, or -1 if it is not running */
+static gint launcher_fd = -1;
+
+static gboolean read_all(gint fd, gpointer buf, gsize len)
+{
+    gsize done = 0;
+
+    while (done < len) {
+        gssize n = read(fd, (gchar*)buf + done, len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return FALSE;
+        done += n;
+    }
+    return TRUE;
+}
+
+/*! Returns FALSE if the other end has gone away, without raising SIGPIPE */
+static gboolean write_all(gint fd, gconstpointer buf, gsize len)
+{
+    gsize done = 0;
+
+    while (done < len) {
+        gssize n = send(fd, (const gchar*)buf + done, len - done,
+                        MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return FALSE;
+        done += n;
+    }
+    return TRUE;
+}
+
+/*! Splits a request into its argv and envp, which point into the request.
+  Returns FALSE if the request is not valid. */
+static gboolean launcher_parse(gchar *req, guint32 len,
+                               gchar ***argv, gchar ***envp)
+{
+    guint32 argc, envc, i;
+    gchar **v, *p, *end;
+
+    if (len < 2 * sizeof(guint32)) return FALSE;
+    memcpy(&argc, req, sizeof(guint32));
+    memcpy(&envc, req + sizeof(guint32), sizeof(guint32));
+    /* every string takes at least one byte */
+    if (argc == 0 || argc > len || envc > len) return FALSE;
+
+    v = g_new(gchar*, argc + envc + 2);
+    p = req + 2 * sizeof(guint32);
+    end = req + len;
+    for (i = 0; i < argc + envc; ++i) {
+        gchar *z = memchr(p, '\0', end - p);
+
+        if (!z) {
+            g_free(v);
+            return FALSE;
+        }
+        v[i < argc ? i : i + 1] = p;
+        p = z + 1;
+    }
+    v[argc] = NULL;
+    v[argc + envc + 1] = NULL;
+
+    *argv = v;
+    *envp = v + argc + 1;
+    return TRUE;
+}
+
+static void launcher_reap(gint signal)
+{
+    gint olderrno = errno;
+
+    while (waitpid(-1, NULL, WNOHANG) > 0);
+    errno = olderrno;
+}
+
+/*! The launcher process.  It starts whatever it is asked to until the
+  window manager closes its end of the socket. */
+static void launcher_run(gint fd)
+{
+    struct sigaction action;
+    posix_spawnattr_t attr;
+    sigset_t none;
+    glong i, max;
+
+    /* the programs it starts should not get any of our files, the way
+       g_spawn_async closes them too */
+    max = sysconf(_SC_OPEN_MAX);
+    for (i = 3; i < max; ++i)
+        if (i != fd) close(i);
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = launcher_reap;
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &action, NULL);
+
+    sigemptyset(&none);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    for (;;) {
+        guint32 len;
+        gchar *req, **argv, **envp;
+        gint32 ret;
+        pid_t pid;
+
+        if (!read_all(fd, &len, sizeof(len)) || len > MAX_REQUEST)
+            break;
+        req = g_malloc(len);
+        if (!read_all(fd, req, len))
+            break;
+
+        if (!launcher_parse(req, len, &argv, &envp))
+            ret = -EINVAL;
+        else {
+            /* posix_spawnp looks through the PATH in our own environment,
+               so use the one the program is being run with */
+            for (i = 0; envp[i]; ++i)
+                if (!strncmp(envp[i], "PATH=", 5)) break;
+            if (envp[i])
+                setenv("PATH", envp[i] + 5, 1);
+            else
+                unsetenv("PATH");
+
+            ret = posix_spawnp(&pid, argv[0], NULL, &attr, argv, envp);
+            ret = ret ? -ret : (gint32)pid;
+            g_free(argv);
+        }
+        g_free(req);
+
+        if (!write_all(fd, &ret, sizeof(ret)))
+            break;
+    }
+    _exit(0);
+}
+
+void launcher_startup(void)
+{
+    gint fds[2];
+    pid_t pid;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        ob_debug("Unable to make a socket for the launcher: %s",
+                 g_strerror(errno));
+        return;
+    }
+    /* nothing else should hold the socket open, or the launcher won't see
+       it close when we exit or restart */
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        launcher_run(fds[1]);
+    }
+    close(fds[1]);
+
+    if (pid < 0) {
+        ob_debug("Unable to start the launcher: %s", g_strerror(errno));
+        close(fds[0]);
+        return;
+    }
+    launcher_fd = fds[0];
+}
+
+void launcher_shutdown(void)
+{
+    /* the launcher exits when it sees this close */
+    if (launcher_fd >= 0) {
+        close(launcher_fd);
+        launcher_fd = -1;
+    }
+}
+
+static void append_string(GByteArray *buf, const gchar *s)
+{
+    g_byte_array_append(buf, (const guint8*)s, strlen(s) + 1);
+}
+
+/*! Asks the launcher to run a program.  Returns its pid, a negative errno
+  value if it could not be run, or 0 if the launcher could not be used */
+static gint32 launcher_request(gchar **argv)
+{
+    GByteArray *req;
+    gchar **env;
+    guint32 head[3];
+    gint32 ret;
+    gint i;
+
+    env = g_get_environ();
+
+    req = g_byte_array_sized_new(4096);
+    g_byte_array_set_size(req, sizeof(head));
+    for (i = 0; argv[i]; ++i)
+        append_string(req, argv[i]);
+    head[1] = i;
+    for (i = 0; env[i]; ++i)
+        append_string(req, env[i]);
+    head[2] = i;
+    head[0] = req->len - sizeof(guint32);
+    memcpy(req->data, head, sizeof(head));
+
+    g_strfreev(env);
+
+    if (head[0] > MAX_REQUEST)
+        ret = 0;
+    else if (!write_all(launcher_fd, req->data, req->len) ||
+             !read_all(launcher_fd, &ret, sizeof(ret)))
+    {
+        ob_debug("The launcher has stopped, running programs directly");
+        launcher_shutdown();
+        ret = 0;
+    }
+
+    g_byte_array_free(req, TRUE);
+    return ret;
+}
+
+#else
+
+void launcher_startup(void) {}
+void launcher_shutdown(void) {}
+
+#endif
+
+gboolean launcher_spawn(gchar **argv, GError **error)
+{
+#ifdef HAVE_SPAWN_H
+    if (launcher_fd >= 0) {
+        gint32 ret = launcher_request(argv);
+
+        if (ret > 0)
+            return TRUE;
+        if (ret < 0) {
+            g_set_error(error, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED,
+                        _("Failed to execute \"%s\": %s"),
+                        argv[0], g_strerror(-ret));
+            return FALSE;
+        }
+    }
+#endif
+    return g_spawn_async(NULL, argv, NULL,
+                         G_SPAWN_SEARCH_PATH |
+                         G_SPAWN_DO_NOT_REAP_CHILD,
+                         NULL, NULL, NULL, error);
+}
@@ -0,0 +1,38 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   launcher.h for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __ob__launcher_h
+#define __ob__launcher_h
+
+#include <glib.h>
+
+/*! Forks the launcher process.  This must be done before the display is
+  opened or any threads are started, while the process is still small. */
+void launcher_startup(void);
+void launcher_shutdown(void);
+
+/*! Runs a program in the background, searching the PATH for it, with the
+  current environment.  The launcher process starts it with posix_spawn, so
+  that the window manager's memory doesn't have to be copied for it.  If the
+  launcher is not running then the program is started with g_spawn_async
+  instead.
+  @return FALSE and sets error if the program could not be run
+*/
+gboolean launcher_spawn(gchar **argv, GError **error);
+
+#endif
@@ -78,6 +78,28 @@ static void client_dest(ObClient *client, gpointer data)
     }
 }
 
+static void icon_loaded(RrImage *image, gpointer data)
+{
+    GList *it, *eit;
+
+    /* the icon was empty when these were drawn, so draw them again */
+    for (it = menu_frame_visible; it; it = g_list_next(it)) {
+        ObMenuFrame *f = it->data;
+
+        for (eit = f->entries; eit; eit = g_list_next(eit)) {
+            ObMenuEntry *e = ((ObMenuEntryFrame*)eit->data)->entry;
+
+            if ((e->type == OB_MENU_ENTRY_TYPE_NORMAL ||
+                 e->type == OB_MENU_ENTRY_TYPE_SUBMENU) &&
+                e->data.normal.icon == image)
+            {
+                menu_frame_render(f);
+                break;
+            }
+        }
+    }
+}
+
 void menu_frame_startup(gboolean reconfig)
 {
     gint i;
@@ -93,6 +115,7 @@ void menu_frame_startup(gboolean reconfig)
     if (reconfig) return;
 
     client_add_destroy_notify(client_dest, NULL);
+    RrImageCacheSetLoadedFunc(ob_rr_icons, icon_loaded, NULL);
     menu_frame_map = g_hash_table_new(g_int_hash, g_int_equal);
 }
 
@@ -103,6 +126,7 @@ void menu_frame_shutdown(gboolean reconfig)
     if (reconfig) return;
 
     client_remove_destroy_notify(client_dest);
+    RrImageCacheSetLoadedFunc(ob_rr_icons, NULL, NULL);
     g_hash_table_destroy(menu_frame_map);
 }
 
@@ -0,0 +1,272 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   metrics.c for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "metrics.h"
+#include "openbox.h"
+#include "client.h"
+#include "frame.h"
+#include "obrender/render.h"
+#include "obrender/theme.h"
+#include "obt/display.h"
+#include "obt/xqueue.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+
+gint ob_metrics[OB_NUM_METRICS];
+
+/*! The upper bounds of the buckets for the time the server is held by a
+  grab, in microseconds */
+static const gint64 grab_buckets[] = {
+    100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000
+};
+#define NUM_GRAB_BUCKETS G_N_ELEMENTS(grab_buckets)
+
+typedef struct {
+    const gchar *site;
+    /* grabs in each bucket, and the last one for those longer than all of
+       the buckets */
+    guint64 count[NUM_GRAB_BUCKETS + 1];
+    gint64 time;
+} ObGrabSite;
+
+static gint64 grab_time = 0;
+/*! Maps where a grab was taken to its ObGrabSite */
+static GHashTable *grab_sites = NULL;
+
+void metrics_add_grab_time(const gchar *site, gint64 usec)
+{
+    ObGrabSite *s;
+    guint i;
+
+    grab_time += usec;
+
+    if (!grab_sites)
+        grab_sites = g_hash_table_new(g_str_hash, g_str_equal);
+    if (!(s = g_hash_table_lookup(grab_sites, site))) {
+        s = g_new0(ObGrabSite, 1);
+        s->site = site;
+        g_hash_table_insert(grab_sites, (gpointer)site, s);
+    }
+
+    for (i = 0; i < NUM_GRAB_BUCKETS && usec > grab_buckets[i]; ++i);
+    ++s->count[i];
+    s->time += usec;
+}
+
+static void add(GString *out, const gchar *name, const gchar *type,
+                const gchar *help, guint64 value)
+{
+    g_string_append_printf(out,
+                           "# HELP openbox_%s %s\n"
+                           "# TYPE openbox_%s %s\n"
+                           "openbox_%s %" G_GUINT64_FORMAT "\n",
+                           name, help, name, type, name, value);
+}
+
+static void add_double(GString *out, const gchar *name, const gchar *type,
+                       const gchar *help, gdouble value)
+{
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append_printf(out,
+                           "# HELP openbox_%s %s\n"
+                           "# TYPE openbox_%s %s\n"
+                           "openbox_%s %s\n",
+                           name, help, name, type, name,
+                           g_ascii_dtostr(buf, sizeof(buf), value));
+}
+
+static gint grab_site_cmp(gconstpointer a, gconstpointer b)
+{
+    return strcmp(((const ObGrabSite*)a)->site, ((const ObGrabSite*)b)->site);
+}
+
+static void add_grab_histogram(GString *out)
+{
+    GList *sites, *it;
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    if (!grab_sites) return;
+
+    g_string_append(out,
+                    "# HELP openbox_server_grab_duration_seconds "
+                    "How long each grab held the X server, by where it was "
+                    "taken\n"
+                    "# TYPE openbox_server_grab_duration_seconds histogram\n");
+
+    sites = g_list_sort(g_hash_table_get_values(grab_sites), grab_site_cmp);
+    for (it = sites; it; it = g_list_next(it)) {
+        ObGrabSite *s = it->data;
+        guint64 n = 0;
+        guint i;
+
+        for (i = 0; i < NUM_GRAB_BUCKETS; ++i) {
+            n += s->count[i];
+            g_string_append_printf(out,
+                                   "openbox_server_grab_duration_seconds_bucket"
+                                   "{site=\"%s\",le=\"%s\"} %"
+                                   G_GUINT64_FORMAT "\n", s->site,
+                                   g_ascii_dtostr(buf, sizeof(buf),
+                                                  grab_buckets[i] / 1e6),
+                                   n);
+        }
+        n += s->count[NUM_GRAB_BUCKETS];
+        g_string_append_printf(out,
+                               "openbox_server_grab_duration_seconds_bucket"
+                               "{site=\"%s\",le=\"+Inf\"} %"
+                               G_GUINT64_FORMAT "\n", s->site, n);
+        g_string_append_printf(out,
+                               "openbox_server_grab_duration_seconds_sum"
+                               "{site=\"%s\"} %s\n", s->site,
+                               g_ascii_dtostr(buf, sizeof(buf),
+                                              s->time / 1e6));
+        g_string_append_printf(out,
+                               "openbox_server_grab_duration_seconds_count"
+                               "{site=\"%s\"} %" G_GUINT64_FORMAT "\n",
+                               s->site, n);
+    }
+    g_list_free(sites);
+}
+
+/*! Returns the resident set size of the process in bytes, or 0 if it can't
+  be found */
+static guint64 resident_bytes(void)
+{
+    guint64 rss = 0;
+#ifdef HAVE_UNISTD_H
+    FILE *f;
+    unsigned long size, resident;
+
+    if ((f = fopen("/proc/self/statm", "r"))) {
+        if (fscanf(f, "%lu %lu", &size, &resident) == 2)
+            rss = (guint64)resident * sysconf(_SC_PAGESIZE);
+        fclose(f);
+    }
+#endif
+    return rss;
+}
+
+/*! Adds up the cache counters of the theme's fonts */
+static void font_stats(RrFontCacheStats *sum)
+{
+    RrFont *fonts[] = {
+        ob_rr_theme->win_font_focused,
+        ob_rr_theme->win_font_unfocused,
+        ob_rr_theme->menu_title_font,
+        ob_rr_theme->menu_font,
+        ob_rr_theme->osd_font_hilite,
+        ob_rr_theme->osd_font_unhilite
+    };
+    guint i, j;
+
+    memset(sum, 0, sizeof(*sum));
+    for (i = 0; i < G_N_ELEMENTS(fonts); ++i) {
+        RrFontCacheStats s;
+
+        if (!fonts[i]) continue;
+        /* the same font can be used for more than one thing */
+        for (j = 0; j < i && fonts[j] != fonts[i]; ++j);
+        if (j < i) continue;
+
+        RrFontGetCacheStats(fonts[i], &s);
+        sum->extents_lookups += s.extents_lookups;
+        sum->extents_hits += s.extents_hits;
+        sum->layout_lookups += s.layout_lookups;
+        sum->layout_hits += s.layout_hits;
+    }
+}
+
+void metrics_export(GString *out)
+{
+    GList *it;
+    guint clients = 0, frames = 0;
+    RrImageCacheStats icons;
+    RrFontCacheStats fonts;
+
+    for (it = client_list; it; it = g_list_next(it)) {
+        ObClient *c = it->data;
+
+        ++clients;
+        if (c->frame->realized) ++frames;
+    }
+    RrImageCacheGetStats(ob_rr_icons, &icons);
+    font_stats(&fonts);
+
+    add(out, "clients", "gauge",
+        "Windows being managed", clients);
+    add(out, "frames_realized", "gauge",
+        "Frames which have their decoration windows created", frames);
+    add(out, "clients_managed_total", "counter",
+        "Windows which have been managed",
+        (guint)g_atomic_int_get(&ob_metrics[OB_METRIC_CLIENTS_MANAGED]));
+    add(out, "clients_unmanaged_total", "counter",
+        "Windows which have stopped being managed",
+        (guint)g_atomic_int_get(&ob_metrics[OB_METRIC_CLIENTS_UNMANAGED]));
+    add(out, "x_requests_total", "counter",
+        "Requests sent to the X server",
+        NextRequest(obt_display) - 1);
+    add(out, "x_round_trips_total", "counter",
+        "Property reads and syncs which waited for a reply from the X server",
+        (guint)g_atomic_int_get(&obt_display_round_trips));
+    add(out, "x_events_total", "counter",
+        "Events processed from the X server",
+        (guint)g_atomic_int_get(&ob_metrics[OB_METRIC_EVENTS]));
+    add(out, "x_event_queue_length", "gauge",
+        "Events read from the X server and not processed yet",
+        xqueue_length());
+    add(out, "server_grabs_total", "counter",
+        "Times the X server was grabbed",
+        (guint)g_atomic_int_get(&ob_metrics[OB_METRIC_SERVER_GRABS]));
+    add_double(out, "server_grab_seconds_total", "counter",
+               "Time the X server was held by grabs",
+               grab_time / 1e6);
+    add_grab_histogram(out);
+    add(out, "paints_total", "counter",
+        "Times an appearance was painted", RrPaintCount());
+    add(out, "icon_cache_pictures", "gauge",
+        "Pictures held in the icon cache", icons.pictures);
+    add(out, "icon_cache_bytes", "gauge",
+        "Pixel data held in the icon cache", icons.bytes);
+    add(out, "icon_cache_resized_pictures", "gauge",
+        "Resized copies of icons held in the icon cache", icons.resized);
+    add(out, "icon_cache_resized_bytes", "gauge",
+        "Pixel data held in resized copies of icons", icons.resized_bytes);
+    add(out, "icon_cache_lookups_total", "counter",
+        "Times an icon was drawn", icons.lookups);
+    add(out, "icon_cache_hits_total", "counter",
+        "Times an icon was drawn without having to be resized", icons.hits);
+    add(out, "icon_cache_evictions_total", "counter",
+        "Resized icons thrown away to keep the icon cache small",
+        icons.evictions);
+    add(out, "font_extents_lookups_total", "counter",
+        "Times the size of some text was measured", fonts.extents_lookups);
+    add(out, "font_extents_hits_total", "counter",
+        "Times the size of some text was found in the font's cache",
+        fonts.extents_hits);
+    add(out, "font_layout_lookups_total", "counter",
+        "Times some text was laid out to be drawn", fonts.layout_lookups);
+    add(out, "font_layout_hits_total", "counter",
+        "Times a layout was found in the font's cache", fonts.layout_hits);
+    add(out, "resident_memory_bytes", "gauge",
+        "Resident set size of the process", resident_bytes());
+}
@@ -0,0 +1,47 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   metrics.h for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __ob__metrics_h
+#define __ob__metrics_h
+
+#include <glib.h>
+
+/*! Counters which only ever go up.  Anything that can be read when the
+  metrics are exported is not counted, and is looked up then instead. */
+typedef enum {
+    OB_METRIC_CLIENTS_MANAGED,
+    OB_METRIC_CLIENTS_UNMANAGED,
+    OB_METRIC_EVENTS,
+    OB_METRIC_SERVER_GRABS,
+    OB_NUM_METRICS
+} ObMetric;
+
+extern gint ob_metrics[OB_NUM_METRICS];
+
+#define metrics_inc(m) g_atomic_int_inc(&ob_metrics[m])
+
+/*! Add the time the server was held by a grab, in microseconds.  The site
+  is where the grab was taken, and must be a static string such as
+  G_STRLOC. */
+void metrics_add_grab_time(const gchar *site, gint64 usec);
+
+/*! Appends all of the metrics to the string, in the Prometheus text
+  exposition format */
+void metrics_export(GString *out);
+
+#endif
@@ -25,6 +25,7 @@
 #include "grab.h"
 #include "frame.h"
 #include "translate.h"
+#include "debug.h"
 #include "mouse.h"
 #include "gettext.h"
 #include "obt/display.h"
@@ -98,37 +99,123 @@ ObFrameContext mouse_button_frame_context(ObFrameContext context,
         return x;
 }
 
-void mouse_grab_for_client(ObClient *client, gboolean grab)
+/*! The windows which buttons are grabbed on for a client */
+typedef enum {
+    GRAB_FRAME,   /*!< the frame of a normal client */
+    GRAB_CLIENT,  /*!< the window of a normal client */
+    GRAB_DESKTOP, /*!< the window of a desktop window */
+    NUM_GRABS
+} ObMouseGrabWindow;
+
+/*! The context whose bindings are grabbed on each kind of window */
+static const ObFrameContext grab_context[NUM_GRABS] = {
+    OB_FRAME_CONTEXT_FRAME,
+    OB_FRAME_CONTEXT_CLIENT,
+    OB_FRAME_CONTEXT_DESKTOP
+};
+
+/*! Arrays of the ObButtonGrabs for each kind of window.  They are made from
+  the bindings in mouse_startup, and stay the same until the next time, so
+  they always match what is grabbed on the clients. */
+static GArray *grab_plan[NUM_GRABS];
+
+static GArray* grab_plan_new(ObFrameContext context)
 {
-    gint i;
+    GArray *a;
     GSList *it;
 
-    for (i = 0; i < OB_FRAME_NUM_CONTEXTS; ++i)
-        for (it = bound_contexts[i]; it; it = g_slist_next(it)) {
-            /* grab/ungrab the button */
-            ObMouseBinding *b = it->data;
-            Window win;
-            gint mode;
-            guint mask;
-
-            if (FRAME_CONTEXT(i, client)) {
-                win = client->frame->window;
-                mode = GrabModeAsync;
-                mask = ButtonPressMask | ButtonMotionMask | ButtonReleaseMask;
-            } else if (CLIENT_CONTEXT(i, client)) {
-                win = client->window;
-                mode = GrabModeSync; /* this is handled in event */
-                mask = ButtonPressMask; /* can't catch more than this with Sync
-                                           mode the release event is
-                                           manufactured in event() */
-            } else continue;
-
-            if (grab)
-                grab_button_full(b->button, b->state, win, mask, mode,
-                                 OB_CURSOR_NONE);
-            else
-                ungrab_button(b->button, b->state, win);
+    a = g_array_new(FALSE, FALSE, sizeof(ObButtonGrab));
+    for (it = bound_contexts[context]; it; it = g_slist_next(it)) {
+        ObMouseBinding *b = it->data;
+        ObButtonGrab g;
+
+        g.button = b->button;
+        g.state = b->state;
+        g_array_append_val(a, g);
+    }
+    return a;
+}
+
+/*! Returns a new array with the grabs in a that are not in b */
+static GArray* grab_plan_minus(GArray *a, GArray *b)
+{
+    GArray *r;
+    guint i, j;
+
+    r = g_array_new(FALSE, FALSE, sizeof(ObButtonGrab));
+    for (i = 0; i < a->len; ++i) {
+        ObButtonGrab *ga = &g_array_index(a, ObButtonGrab, i);
+
+        for (j = 0; j < b->len; ++j) {
+            ObButtonGrab *gb = &g_array_index(b, ObButtonGrab, j);
+
+            if (ga->button == gb->button && ga->state == gb->state)
+                break;
         }
+        if (j == b->len)
+            g_array_append_val(r, *ga);
+    }
+    return r;
+}
+
+/*! Ungrabs the buttons in remove and grabs the ones in add, on all of the
+  client's windows.  Either one can be NULL.  This waits for the X server
+  only once, no matter how many buttons are grabbed. */
+static void grab_client_buttons(ObClient *client, GArray *const *add,
+                                GArray *const *remove)
+{
+    ObMouseGrabWindow w;
+    gboolean grabbed = FALSE;
+
+    for (w = 0; w < NUM_GRABS; ++w) {
+        Window win;
+        gint mode;
+        guint mask;
+
+        if ((w == GRAB_DESKTOP) != (client->type == OB_CLIENT_TYPE_DESKTOP))
+            continue;
+
+        if (w == GRAB_FRAME) {
+            win = client->frame->window;
+            mode = GrabModeAsync;
+            mask = ButtonPressMask | ButtonMotionMask | ButtonReleaseMask;
+        } else {
+            win = client->window;
+            mode = GrabModeSync; /* this is handled in event */
+            mask = ButtonPressMask; /* can't catch more than this with Sync
+                                       mode the release event is
+                                       manufactured in event() */
+        }
+
+        if (remove && remove[w]->len)
+            ungrab_button_list((ObButtonGrab*)remove[w]->data,
+                               remove[w]->len, win);
+        if (add && add[w]->len) {
+            /* can get BadAccess from these */
+            if (!grabbed) obt_display_ignore_errors(TRUE);
+            grabbed = TRUE;
+            grab_button_list((ObButtonGrab*)add[w]->data, add[w]->len,
+                             win, mask, mode, OB_CURSOR_NONE);
+        }
+    }
+
+    if (grabbed) {
+        obt_display_ignore_errors(FALSE);
+        if (obt_display_error_occured)
+            ob_debug("Failed to grab some buttons on window 0x%x",
+                     client->window);
+    }
+}
+
+void mouse_grab_for_client(ObClient *client, gboolean grab)
+{
+    /* nothing is grabbed before the bindings are loaded */
+    if (!grab_plan[0]) return;
+
+    if (grab)
+        grab_client_buttons(client, grab_plan, NULL);
+    else
+        grab_client_buttons(client, NULL, grab_plan);
 }
 
 static void grab_all_clients(gboolean grab)
@@ -403,11 +490,54 @@ gboolean mouse_bind(const gchar *buttonstr, ObFrameContext context,
 
 void mouse_startup(gboolean reconfig)
 {
-    grab_all_clients(TRUE);
+    GArray *plan[NUM_GRABS];
+    ObMouseGrabWindow w;
+
+    for (w = 0; w < NUM_GRABS; ++w)
+        plan[w] = grab_plan_new(grab_context[w]);
+
+    if (grab_plan[0]) {
+        /* the buttons for the old bindings are still grabbed, so only
+           change the ones which are different */
+        GArray *add[NUM_GRABS], *remove[NUM_GRABS];
+        gboolean changed = FALSE;
+        GList *it;
+
+        for (w = 0; w < NUM_GRABS; ++w) {
+            add[w] = grab_plan_minus(plan[w], grab_plan[w]);
+            remove[w] = grab_plan_minus(grab_plan[w], plan[w]);
+            changed = changed || add[w]->len || remove[w]->len;
+        }
+
+        if (changed)
+            for (it = client_list; it; it = g_list_next(it))
+                grab_client_buttons(it->data, add, remove);
+
+        for (w = 0; w < NUM_GRABS; ++w) {
+            g_array_free(add[w], TRUE);
+            g_array_free(remove[w], TRUE);
+            g_array_free(grab_plan[w], TRUE);
+            grab_plan[w] = plan[w];
+        }
+    } else {
+        for (w = 0; w < NUM_GRABS; ++w)
+            grab_plan[w] = plan[w];
+        grab_all_clients(TRUE);
+    }
 }
 
 void mouse_shutdown(gboolean reconfig)
 {
-    grab_all_clients(FALSE);
+    ObMouseGrabWindow w;
+
+    /* when reconfiguring, the grabs are left in place for mouse_startup to
+       compare with the new bindings */
+    if (!reconfig) {
+        grab_all_clients(FALSE);
+        for (w = 0; w < NUM_GRABS; ++w) {
+            g_array_free(grab_plan[w], TRUE);
+            grab_plan[w] = NULL;
+        }
+    }
     mouse_unbind_all();
 }
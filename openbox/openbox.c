@@ -20,8 +20,12 @@
 #include "debug.h"
 #include "openbox.h"
 #include "session.h"
+#include "restart.h"
+#include "control.h"
+#include "launcher.h"
 #include "dock.h"
 #include "event.h"
+#include "animation.h"
 #include "menu.h"
 #include "client.h"
 #include "screen.h"
@@ -100,12 +104,16 @@ static gboolean  xsync = FALSE;
 static gboolean  reconfigure = FALSE;
 static gboolean  restart = FALSE;
 static gchar    *restart_path = NULL;
+static gchar    *restart_state = NULL;
 static Cursor    cursors[OB_NUM_CURSORS];
 static gint      exitcode = 0;
 static guint     remote_control = 0;
 static gboolean  being_replaced = FALSE;
 static gchar    *config_file = NULL;
 static gchar    *startup_cmd = NULL;
+static gboolean  startup_profile = FALSE;
+static gint64    profile_start;
+static gint64    profile_last;
 
 static void signal_handler(gint signal, gpointer data);
 static void remove_args(gint *argc, gchar **argv, gint index, gint num);
@@ -113,6 +121,9 @@ static void parse_env();
 static void parse_args(gint *argc, gchar **argv);
 static Cursor load_cursor(const gchar *name, guint fontval);
 static void run_startup_cmd(void);
+static void preload_config(void);
+static void preload_menus(void);
+static void profile(const gchar *part);
 
 gint main(gint argc, gchar **argv)
 {
@@ -142,14 +153,25 @@ gint main(gint argc, gchar **argv)
     /* parse the environment variables */
     parse_env();
 
+    /* start the launcher while this process is still small, before it has
+       any threads or a connection to the display */
+    if (!remote_control)
+        launcher_startup();
+
+    profile_start = profile_last = g_get_monotonic_time();
+
     program_name = g_path_get_basename(argv[0]);
     g_set_prgname(program_name);
 
-    if (!remote_control)
+    if (!remote_control) {
+        /* parse the config file while the display is being set up */
+        preload_config();
         session_startup(argc, argv);
+    }
 
     if (!obt_display_open(NULL))
         ob_exit_with_error(_("Failed to open the display from the DISPLAY environment variable."));
+    profile("display");
 
     if (remote_control) {
         /* Send client message telling the OB process to:
@@ -185,6 +207,10 @@ gint main(gint argc, gchar **argv)
        and the alt-tab icon
     */
     ob_rr_icons = RrImageCacheNew(3);
+    /* and don't let them add up to much across all of the windows, which
+       come and go with different icons over a long session */
+    RrImageCacheSetMaxResizedBytes(ob_rr_icons, 2 * 1024 * 1024);
+    profile("render");
 
     XSynchronize(obt_display, xsync);
 
@@ -216,8 +242,10 @@ gint main(gint argc, gchar **argv)
     cursors[OB_CURSOR_WEST] = load_cursor("left_side", XC_left_side);
     cursors[OB_CURSOR_NORTHWEST] = load_cursor("top_left_corner",
                                                XC_top_left_corner);
+    profile("cursors");
 
     if (screen_annex()) { /* it will be ours! */
+        profile("annex");
 
         /* get a timestamp from after taking over as the WM.  if we use the
            old timestamp to set focus it can fail when replacing another WM. */
@@ -227,7 +255,10 @@ gint main(gint argc, gchar **argv)
             gchar *xml_error_string = NULL;
             ObPrompt *xmlprompt = NULL;
 
-            if (reconfigure) obt_keyboard_reload();
+            if (reconfigure) {
+                obt_keyboard_reload();
+                preload_config();
+            }
 
             {
                 ObtXmlInst *i;
@@ -275,7 +306,12 @@ gint main(gint argc, gchar **argv)
 
                 /* we're done with parsing now, kill it */
                 obt_xml_instance_unref(i);
+
+                /* the config says which menus to load, so parse them while
+                   everything else starts up */
+                preload_menus();
             }
+            profile("config");
 
             /* load the theme specified in the rc file */
             {
@@ -297,6 +333,7 @@ gint main(gint argc, gchar **argv)
                 OBT_PROP_SETS(obt_root(ob_screen), OB_THEME,
                               ob_rr_theme->name);
             }
+            profile("theme");
 
             if (reconfigure) {
                 GList *it;
@@ -308,6 +345,8 @@ gint main(gint argc, gchar **argv)
                 }
             }
             event_startup(reconfigure);
+            animation_startup(reconfigure);
+            profile("events");
             /* focus_backup is used for stacking, so this needs to come before
                anything that calls stacking_add */
             sn_startup(reconfigure);
@@ -316,18 +355,28 @@ gint main(gint argc, gchar **argv)
             focus_cycle_startup(reconfigure);
             focus_cycle_indicator_startup(reconfigure);
             focus_cycle_popup_startup(reconfigure);
+            profile("focus");
             screen_startup(reconfigure);
+            profile("screen");
             grab_startup(reconfigure);
             group_startup(reconfigure);
             ping_startup(reconfigure);
             client_startup(reconfigure);
             dock_startup(reconfigure);
             moveresize_startup(reconfigure);
+            profile("clients");
             keyboard_startup(reconfigure);
+            profile("keyboard");
             mouse_startup(reconfigure);
+            profile("mouse");
             menu_frame_startup(reconfigure);
             menu_startup(reconfigure);
             prompt_startup(reconfigure);
+            profile("menus");
+            control_startup(reconfigure);
+
+            /* anything preloaded which wasn't used */
+            obt_xml_preload_clear();
 
             if (!reconfigure) {
                 /* do this after everything is started so no events will get
@@ -337,8 +386,15 @@ gint main(gint argc, gchar **argv)
                 guint32 xid;
                 ObWindow *w;
 
+                /* pick up where the previous process left off */
+                if (restart_state) restart_load(restart_state);
+
                 /* get all the existing windows */
                 window_manage_all();
+                restart_restore_focus_order();
+                restart_clear();
+                session_report_restore();
+                profile("windows");
 
                 /* focus what was focused if a wm was already running */
                 if (OBT_PROP_GET32(obt_root(ob_screen),
@@ -349,6 +405,12 @@ gint main(gint argc, gchar **argv)
                 }
             } else {
                 GList *it;
+                RrPrerender *pre;
+
+                /* find the surfaces for every frame first, and render them
+                   all at once before painting the frames */
+                pre = RrPrerenderNew();
+                framerender_prerender(pre);
 
                 /* redecorate all existing windows */
                 for (it = client_list; it; it = g_list_next(it)) {
@@ -362,6 +424,21 @@ gint main(gint argc, gchar **argv)
                        end up in new positions */
                     client_reconfigure(c, FALSE);
                 }
+
+                framerender_prerender(NULL);
+                RrPrerenderRun(pre);
+                for (it = client_list; it; it = g_list_next(it)) {
+                    ObClient *c = it->data;
+                    framerender_frame(c->frame);
+                }
+                RrPrerenderFree(pre);
+            }
+
+            if (startup_profile) {
+                g_print("%-12s %8.2f ms\n", "total",
+                        (g_get_monotonic_time() - profile_start) / 1000.0);
+                /* only the first startup is profiled */
+                startup_profile = FALSE;
             }
 
             ob_set_state(OB_STATE_RUNNING);
@@ -388,9 +465,15 @@ gint main(gint argc, gchar **argv)
                 xmlprompt = NULL;
             }
 
+            /* hand over to the new process before letting go of the
+               windows, unless it is someone else */
+            if (restart && !restart_path)
+                restart_save();
+
             if (!reconfigure)
                 window_unmanage_all();
 
+            control_shutdown(reconfigure);
             prompt_shutdown(reconfigure);
             menu_shutdown(reconfigure);
             menu_frame_shutdown(reconfigure);
@@ -409,11 +492,15 @@ gint main(gint argc, gchar **argv)
             focus_shutdown(reconfigure);
             window_shutdown(reconfigure);
             sn_shutdown(reconfigure);
+            animation_shutdown(reconfigure);
             event_shutdown(reconfigure);
             config_shutdown();
             actions_shutdown(reconfigure);
         } while (reconfigure);
     }
+    else
+        /* don't leave the preloading thread running while exiting */
+        obt_xml_preload_clear();
 
     XSync(obt_display, FALSE);
 
@@ -422,6 +509,7 @@ gint main(gint argc, gchar **argv)
     RrInstanceFree(ob_rr_inst);
 
     session_shutdown(being_replaced);
+    launcher_shutdown();
 
     obt_display_close();
 
@@ -480,6 +568,7 @@ gint main(gint argc, gchar **argv)
     g_free(ob_sm_save_file);
     g_free(ob_sm_id);
     g_free(program_name);
+    g_free(restart_state);
 
     if (!restart) {
         ob_debug_shutdown();
@@ -550,6 +639,7 @@ static void print_help(void)
     g_print(_("  --debug-focus       Display debugging output for focus handling\n"));
     g_print(_("  --debug-session     Display debugging output for session management\n"));
     g_print(_("  --debug-xinerama    Split the display into fake xinerama screens\n"));
+    g_print(_("  --startup-profile   Show how long each part of starting up takes\n"));
     g_print(_("\nPlease report bugs at %s\n"), PACKAGE_BUGREPORT);
 }
 
@@ -605,6 +695,13 @@ static void parse_env(void)
                       "DESKTOP_AUTOSTART_ID %s supercedes --sm-client-id\n",
                       ob_sm_id);
     }
+
+    /* this is how a restart passes on the state of the previous process */
+    id = g_getenv(RESTART_STATE_ENV);
+    if (id) {
+        restart_state = g_strdup(id);
+        g_unsetenv(RESTART_STATE_ENV);
+    }
 }
 
 static void parse_args(gint *argc, gchar **argv)
@@ -656,6 +753,9 @@ static void parse_args(gint *argc, gchar **argv)
         else if (!strcmp(argv[i], "--debug-xinerama")) {
             ob_debug_xinerama = TRUE;
         }
+        else if (!strcmp(argv[i], "--startup-profile")) {
+            startup_profile = TRUE;
+        }
         else if (!strcmp(argv[i], "--reconfigure")) {
             remote_control = 1;
         }
@@ -716,6 +816,38 @@ static void parse_args(gint *argc, gchar **argv)
     }
 }
 
+static void preload_config(void)
+{
+    if (config_file)
+        obt_xml_preload_file(config_file);
+    else
+        obt_xml_preload_config_file("openbox", "rc.xml");
+}
+
+static void preload_menus(void)
+{
+    GSList *it;
+
+    /* look for them the same way as menu_startup */
+    for (it = config_menu_files; it; it = g_slist_next(it))
+        if (!obt_xml_preload_config_file("openbox", it->data))
+            obt_xml_preload_file(it->data);
+    if (!config_menu_files)
+        obt_xml_preload_config_file("openbox", "menu.xml");
+}
+
+/*! Show how long it has been since the last part of starting up finished */
+static void profile(const gchar *part)
+{
+    gint64 now;
+
+    if (!startup_profile) return;
+
+    now = g_get_monotonic_time();
+    g_print("%-12s %8.2f ms\n", part, (now - profile_last) / 1000.0);
+    profile_last = now;
+}
+
 static Cursor load_cursor(const gchar *name, guint fontval)
 {
     Cursor c = None;
@@ -0,0 +1,371 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   restart.c for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#include "restart.h"
+#include "openbox.h"
+#include "client.h"
+#include "focus.h"
+#include "stacking.h"
+#include "window.h"
+#include "debug.h"
+#include "checksum.h"
+#include "obt/display.h"
+#include "obt/prop.h"
+
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+
+/* The snapshot is only ever read by the process that replaces the one which
+   wrote it, so it is kept in native byte order and every field is 32 bits
+   wide to keep the pixel data aligned.
+
+   The file is a Header followed by n_clients records, from the top of the
+   stacking order to the bottom.  Each record is a Record followed by
+   n_icons pictures, and each picture is its width and height followed by
+   width*height RrPixel32s.
+*/
+
+#define RESTART_MAGIC   0x4f427273 /* "OBrs" */
+#define RESTART_VERSION 1
+
+#define NO_FOCUS G_MAXUINT32
+
+typedef struct _Header Header;
+typedef struct _Record Record;
+typedef struct _RestartClient RestartClient;
+
+struct _Header {
+    guint32 magic;
+    guint32 version;
+    guint32 root;
+    guint32 screen;
+    guint32 n_clients;
+    guint32 size;     /* bytes following the header */
+    guint32 checksum; /* of the bytes following the header */
+};
+
+struct _Record {
+    guint32 window;
+    guint32 focus;      /* position in the focus order, or NO_FOCUS */
+    guint32 icon_bytes; /* size of _NET_WM_ICON when the icons were decoded */
+    guint32 n_icons;
+};
+
+struct _RestartClient {
+    guint stack; /* 1 is the bottom of the stacking order */
+    guint focus;
+    guint32 icon_bytes;
+    guint n_icons;
+    const guint32 *icons;
+};
+
+/*! The contents of the snapshot file, which the RestartClients point into */
+static gchar *contents = NULL;
+/*! Maps a Window to its RestartClient */
+static GHashTable *clients = NULL;
+
+static guint window_hash(Window *w) { return *w; }
+static gboolean window_comp(Window *w1, Window *w2) { return *w1 == *w2; }
+
+static void append32(GByteArray *buf, guint32 v)
+{
+    g_byte_array_append(buf, (guint8*)&v, sizeof(v));
+}
+
+static void save_client(GByteArray *buf, ObClient *c)
+{
+    Record r;
+    RrImageSet *set;
+    gint i;
+
+    r.window = c->window;
+    r.focus = g_list_index(focus_order, c);
+    if (r.focus == (guint32)-1) r.focus = NO_FOCUS;
+    r.n_icons = 0;
+    r.icon_bytes = 0;
+
+    /* only icons that came from _NET_WM_ICON can be checked against the
+       window later */
+    set = c->icon_set ? c->icon_set->set : NULL;
+    if (set && set->n_original > 0 &&
+        (r.icon_bytes = OBT_PROP_SIZE(c->window, NET_WM_ICON)) > 0)
+        r.n_icons = set->n_original;
+    g_byte_array_append(buf, (guint8*)&r, sizeof(r));
+
+    for (i = 0; i < (gint)r.n_icons; ++i) {
+        RrImagePic *pic = set->original[i];
+
+        append32(buf, pic->width);
+        append32(buf, pic->height);
+        g_byte_array_append(buf, (guint8*)pic->data,
+                            pic->width * pic->height * sizeof(RrPixel32));
+    }
+}
+
+void restart_save(void)
+{
+    GByteArray *buf;
+    Header *h;
+    GList *it;
+    gchar *path;
+    gint fd;
+    GError *e = NULL;
+    gboolean ok;
+
+    buf = g_byte_array_sized_new(64 * 1024);
+    g_byte_array_set_size(buf, sizeof(Header));
+
+    h = (Header*)buf->data;
+    h->n_clients = 0;
+    for (it = stacking_list; it; it = g_list_next(it)) {
+        ObClient *c;
+
+        if (!WINDOW_IS_CLIENT(it->data)) continue;
+        c = it->data;
+        /* prompts belong to this process and won't be there after */
+        if (c->prompt) continue;
+
+        save_client(buf, c);
+        ++((Header*)buf->data)->n_clients;
+    }
+
+    /* the array may have moved while it grew */
+    h = (Header*)buf->data;
+    h->magic = RESTART_MAGIC;
+    h->version = RESTART_VERSION;
+    h->root = obt_root(ob_screen);
+    h->screen = ob_screen;
+    h->size = buf->len - sizeof(Header);
+    h->checksum = ob_checksum(buf->data + sizeof(Header), h->size);
+
+    fd = g_file_open_tmp("openbox-restart-XXXXXX", &path, &e);
+    if (fd < 0) {
+        g_message("Unable to save the state for restarting: %s", e->message);
+        g_error_free(e);
+        g_byte_array_free(buf, TRUE);
+        return;
+    }
+
+    ok = TRUE;
+    {
+        gsize done = 0;
+
+        while (ok && done < buf->len) {
+            gssize n = write(fd, buf->data + done, buf->len - done);
+            if (n < 0 && errno != EINTR)
+                ok = FALSE;
+            else if (n > 0)
+                done += n;
+        }
+    }
+    close(fd);
+
+    if (ok) {
+        ob_debug("Saved state for %u clients (%u bytes) to %s",
+                 h->n_clients, buf->len, path);
+        g_setenv(RESTART_STATE_ENV, path, TRUE);
+    } else {
+        g_message("Unable to save the state for restarting: %s",
+                  g_strerror(errno));
+        g_unlink(path);
+    }
+
+    g_free(path);
+    g_byte_array_free(buf, TRUE);
+}
+
+gboolean restart_load(const gchar *path)
+{
+    gsize len, off;
+    Header h;
+    guint i;
+    GError *e = NULL;
+
+    restart_clear();
+
+    if (!g_file_get_contents(path, &contents, &len, &e)) {
+        ob_debug("Unable to read the restart state: %s", e->message);
+        g_error_free(e);
+        return FALSE;
+    }
+    /* it is only good for one restart */
+    g_unlink(path);
+
+    if (len < sizeof(Header)) goto bad;
+    memcpy(&h, contents, sizeof(Header));
+    if (h.magic != RESTART_MAGIC || h.version != RESTART_VERSION ||
+        h.size != len - sizeof(Header) ||
+        h.checksum != ob_checksum((guchar*)contents + sizeof(Header), h.size))
+        goto bad;
+    /* it must be for the screen we are managing */
+    if (h.root != obt_root(ob_screen) || h.screen != (guint32)ob_screen)
+        goto bad;
+
+    clients = g_hash_table_new_full((GHashFunc)window_hash,
+                                    (GEqualFunc)window_comp,
+                                    g_free, g_free);
+    off = sizeof(Header);
+    for (i = 0; i < h.n_clients; ++i) {
+        Record r;
+        RestartClient *rc;
+        Window *key;
+        guint j;
+
+        if (len - off < sizeof(Record)) goto bad;
+        memcpy(&r, contents + off, sizeof(Record));
+        off += sizeof(Record);
+
+        rc = g_new(RestartClient, 1);
+        rc->stack = h.n_clients - i;
+        rc->focus = r.focus;
+        rc->icon_bytes = r.icon_bytes;
+        rc->n_icons = r.n_icons;
+        rc->icons = (const guint32*)(contents + off);
+
+        key = g_new(Window, 1);
+        *key = r.window;
+        g_hash_table_replace(clients, key, rc);
+
+        /* make sure all of the pictures are inside the file */
+        for (j = 0; j < r.n_icons; ++j) {
+            guint32 w, hh;
+
+            if (len - off < 2 * sizeof(guint32)) goto bad;
+            w = ((const guint32*)(contents + off))[0];
+            hh = ((const guint32*)(contents + off))[1];
+            off += 2 * sizeof(guint32);
+            if (w == 0 || hh == 0 || w > G_MAXUINT16 || hh > G_MAXUINT16 ||
+                (len - off) / sizeof(RrPixel32) < (gsize)w * hh)
+                goto bad;
+            off += (gsize)w * hh * sizeof(RrPixel32);
+        }
+    }
+    if (off != len) goto bad;
+
+    ob_debug("Loaded restart state for %u clients", h.n_clients);
+    return TRUE;
+
+bad:
+    g_message("Ignoring the saved state from before restarting, it is not "
+              "valid for this display");
+    restart_clear();
+    return FALSE;
+}
+
+static gint stack_cmp(gconstpointer a, gconstpointer b, gpointer data)
+{
+    RestartClient *ra, *rb;
+    guint sa, sb;
+
+    ra = g_hash_table_lookup(clients, a);
+    rb = g_hash_table_lookup(clients, b);
+    /* windows that weren't saved go on the bottom */
+    sa = ra ? ra->stack : 0;
+    sb = rb ? rb->stack : 0;
+    return sa < sb ? -1 : (sa > sb ? 1 : 0);
+}
+
+void restart_sort_windows(Window *wins, guint n)
+{
+    if (!clients) return;
+
+    /* this sort is stable, so anything not in the snapshot keeps the order
+       XQueryTree gave it */
+    g_qsort_with_data(wins, n, sizeof(Window), stack_cmp, NULL);
+}
+
+static gint focus_cmp(gconstpointer a, gconstpointer b)
+{
+    const RestartClient *ra, *rb;
+
+    ra = g_hash_table_lookup(clients, &(*(ObClient* const*)a)->window);
+    rb = g_hash_table_lookup(clients, &(*(ObClient* const*)b)->window);
+    /* the last one is moved to the top first */
+    return ra->focus > rb->focus ? -1 : (ra->focus < rb->focus ? 1 : 0);
+}
+
+void restart_restore_focus_order(void)
+{
+    GPtrArray *order;
+    GList *it;
+    guint i;
+
+    if (!clients) return;
+
+    order = g_ptr_array_new();
+    for (it = client_list; it; it = g_list_next(it)) {
+        ObClient *c = it->data;
+        RestartClient *rc = g_hash_table_lookup(clients, &c->window);
+
+        if (rc && rc->focus != NO_FOCUS &&
+            g_list_find(focus_order, c))
+            g_ptr_array_add(order, c);
+    }
+    g_ptr_array_sort(order, focus_cmp);
+
+    for (i = 0; i < order->len; ++i)
+        focus_order_to_top(g_ptr_array_index(order, i));
+    g_ptr_array_free(order, TRUE);
+}
+
+RrImage* restart_take_icons(Window win)
+{
+    RestartClient *rc;
+    RrImage *img = NULL;
+    const guint32 *p;
+    guint i;
+
+    if (!clients || !(rc = g_hash_table_lookup(clients, &win)) ||
+        !rc->n_icons)
+        return NULL;
+
+    /* the icons are only good if the property hasn't changed size since
+       they were decoded.  this is checked without fetching the property */
+    if (OBT_PROP_SIZE(win, NET_WM_ICON) == rc->icon_bytes) {
+        p = rc->icons;
+        for (i = 0; i < rc->n_icons; ++i) {
+            const guint32 w = p[0], h = p[1];
+
+            /* the image cache copies the data, so it can point into the
+               file */
+            if (!img)
+                img = RrImageNewFromData(ob_rr_icons, (RrPixel32*)p + 2,
+                                         w, h);
+            else
+                RrImageAddFromData(img, (RrPixel32*)p + 2, w, h);
+            p += 2 + w * h;
+        }
+    }
+    rc->n_icons = 0;
+    return img;
+}
+
+void restart_clear(void)
+{
+    if (clients) {
+        g_hash_table_destroy(clients);
+        clients = NULL;
+    }
+    g_free(contents);
+    contents = NULL;
+}
@@ -0,0 +1,57 @@
+/* -*- indent-tabs-mode: nil; tab-width: 4; c-basic-offset: 4; -*-
+
+   restart.h for the Openbox window manager
+   Copyright (c) 2003-2007   Dana Jansens
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   See the COPYING file for a copy of the GNU General Public License.
+*/
+
+#ifndef __ob__restart_h
+#define __ob__restart_h
+
+#include "obrender/render.h"
+
+#include <X11/Xlib.h>
+#include <glib.h>
+
+/*! The environment variable used to pass the snapshot file to the new
+  process */
+#define RESTART_STATE_ENV "OPENBOX_RESTART_STATE"
+
+/*! Write the state of the managed clients to a file, and point the
+  environment of the restarted process at it.  This must be called while the
+  clients are still managed. */
+void restart_save(void);
+
+/*! Load a snapshot written by restart_save().  The file is removed once it
+  has been read.  Returns FALSE if it does not belong to this display or is
+  damaged, in which case nothing from it is used. */
+gboolean restart_load(const gchar *path);
+
+/*! Reorder the windows to be managed so that they are mapped bottom to top
+  in the stacking order they had before the restart */
+void restart_sort_windows(Window *wins, guint n);
+
+/*! Put the managed clients back in the focus order they had before the
+  restart */
+void restart_restore_focus_order(void);
+
+/*! Returns the icons that were decoded for the window before the restart,
+  or NULL if there are none or the window's _NET_WM_ICON has changed since.
+  The icons are only given out once. */
+RrImage* restart_take_icons(Window win);
+
+/*! Forget the loaded snapshot */
+void restart_clear(void);
+
+#endif
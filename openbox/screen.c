@@ -609,8 +609,10 @@ static gboolean last_desktop_func(gpointer data)
 void screen_set_desktop(guint num, gboolean dofocus)
 {
     GList *it;
+    GSList *show, *hide, *hidden, *sit;
     guint previous;
     gulong ignore_start;
+    GTimer *timer;
 
     g_assert(num < screen_num_desktops);
 
@@ -619,7 +621,7 @@ void screen_set_desktop(guint num, gboolean dofocus)
 
     if (previous == num) return;
 
-    OBT_PROP_SET32(obt_root(ob_screen), NET_CURRENT_DESKTOP, CARDINAL, num);
+    timer = g_timer_new();
 
     /* This whole thing decides when/how to save the screen_last_desktop so
        that it can be restored later if you want */
@@ -700,44 +702,63 @@ void screen_set_desktop(guint num, gboolean dofocus)
     if (moveresize_client)
         client_set_desktop(moveresize_client, num, TRUE, FALSE);
 
-    /* show windows before hiding the rest to lessen the enter/leave events */
-
-    /* show windows from top to bottom */
-    for (it = stacking_list; it; it = g_list_next(it)) {
+    /* figure out everything that is going to change before touching any
+       windows. the windows to show are kept top to bottom, and the windows to
+       hide are kept bottom to top */
+    show = hide = NULL;
+    for (it = g_list_last(stacking_list); it; it = g_list_previous(it)) {
         if (WINDOW_IS_CLIENT(it->data)) {
             ObClient *c = it->data;
-            client_show(c);
+            if (client_should_show(c))
+                show = g_slist_prepend(show, c);
+            else
+                hide = g_slist_prepend(hide, c);
         }
     }
+    hide = g_slist_reverse(hide);
+
+    /* write all the WM_STATE and _NET_WM_STATE changes together at the end */
+    client_defer_wm_state(TRUE);
+
+    /* show windows before hiding the rest to lessen the enter/leave events */
+    client_show_batch(show);
 
     if (dofocus) screen_fallback_focus();
 
-    /* hide windows from bottom to top */
-    for (it = g_list_last(stacking_list); it; it = g_list_previous(it)) {
-        if (WINDOW_IS_CLIENT(it->data)) {
-            ObClient *c = it->data;
-            if (client_hide(c)) {
-                if (c == focus_client) {
-                    /* c was focused and we didn't do fallback clearly so make
-                       sure openbox doesnt still consider the window focused.
-                       this happens when using NextWindow with allDesktops,
-                       since it doesnt want to move focus on desktop change,
-                       but the focus is not going to stay with the current
-                       window, which has now disappeared.
-                       only do this if the client was actually hidden,
-                       otherwise it can keep focus. */
-                    focus_set_client(NULL);
-                }
-            }
+    hidden = client_hide_batch(hide);
+    for (sit = hidden; sit; sit = g_slist_next(sit)) {
+        if (sit->data == focus_client) {
+            /* c was focused and we didn't do fallback clearly so make
+               sure openbox doesnt still consider the window focused.
+               this happens when using NextWindow with allDesktops,
+               since it doesnt want to move focus on desktop change,
+               but the focus is not going to stay with the current
+               window, which has now disappeared.
+               only do this if the client was actually hidden,
+               otherwise it can keep focus. */
+            focus_set_client(NULL);
         }
     }
 
+    client_defer_wm_state(FALSE);
+    OBT_PROP_SET32(obt_root(ob_screen), NET_CURRENT_DESKTOP, CARDINAL, num);
+    XFlush(obt_display);
+
     focus_cycle_addremove(NULL, TRUE);
 
     event_end_ignore_all_enters(ignore_start);
 
     if (event_source_time() != CurrentTime)
         screen_desktop_user_time = event_source_time();
+
+    ob_debug("Switched to desktop %d in %.3f ms (%u shown, %u hidden)",
+             num+1, g_timer_elapsed(timer, NULL) * 1000.0,
+             g_slist_length(show), g_slist_length(hidden));
+
+    g_slist_free(show);
+    g_slist_free(hide);
+    g_slist_free(hidden);
+    g_timer_destroy(timer);
 }
 
 void screen_add_desktop(gboolean current)
@@ -33,6 +33,7 @@ GSList *session_desktop_names = NULL;
 void session_startup(gint argc, gchar **argv) {}
 void session_shutdown(gboolean permanent) {}
 GList* session_state_find(struct _ObClient *c) { return NULL; }
+void session_report_restore(void) {}
 void session_request_logout(gboolean silent) {}
 gboolean session_connected(void) { return FALSE; }
 #else
@@ -42,12 +43,15 @@ gboolean session_connected(void) { return FALSE; }
 #include "client.h"
 #include "focus.h"
 #include "gettext.h"
+#include "checksum.h"
 #include "obt/xml.h"
 #include "obt/paths.h"
 
+#include <glib/gstdio.h>
 #include <time.h>
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifdef HAVE_UNISTD_H
 #  include <sys/types.h>
@@ -89,6 +93,69 @@ static void sm_shutdown_cancelled(SmcConn conn, SmPointer data);
 
 static gboolean session_state_cmp(ObSessionState *s, ObClient *c);
 static void session_state_free(ObSessionState *state);
+static void session_index_clear(void);
+
+/* The binary session is kept in native byte order, as it is only a faster
+   copy of the XML one.  It is a ObSessionBinHeader, followed by the desktop
+   names, and then a ObSessionBinWindow for each window in stacking order
+   from top to bottom.  Each window is followed by its session id or
+   command, name, class and role.  Strings are written as a 32 bit length
+   followed by the string, nul terminated and padded to 32 bits. */
+
+#define SESSION_BIN_SUFFIX  ".bin"
+#define SESSION_BIN_MAGIC   0x4f427373 /* "OBss" */
+#define SESSION_BIN_VERSION 2
+
+typedef enum {
+    SESSION_BIN_ID           = 1 << 0, /* saved by session id, not command */
+    SESSION_BIN_SHADED       = 1 << 1,
+    SESSION_BIN_ICONIC       = 1 << 2,
+    SESSION_BIN_SKIP_PAGER   = 1 << 3,
+    SESSION_BIN_SKIP_TASKBAR = 1 << 4,
+    SESSION_BIN_FULLSCREEN   = 1 << 5,
+    SESSION_BIN_ABOVE        = 1 << 6,
+    SESSION_BIN_BELOW        = 1 << 7,
+    SESSION_BIN_MAX_HORZ     = 1 << 8,
+    SESSION_BIN_MAX_VERT     = 1 << 9,
+    SESSION_BIN_UNDECORATED  = 1 << 10,
+    SESSION_BIN_FOCUSED      = 1 << 11
+} ObSessionBinFlags;
+
+typedef struct {
+    guint32 magic;
+    guint32 version;
+    guint32 size;      /* bytes following the header */
+    guint32 checksum;  /* of the bytes following the header */
+    guint64 xml_size;  /* of the XML file saved along with this */
+    gint64  xml_mtime;
+    gint64  xml_mtime_nsec; /* 0 where stat doesn't give it */
+    gint32  desktop;
+    guint32 num_desktops;
+    guint32 orientation;
+    guint32 start_corner;
+    guint32 columns;
+    guint32 rows;
+    guint32 n_names;
+    guint32 n_windows;
+} ObSessionBinHeader;
+
+typedef struct {
+    guint32 flags;
+    gint32  type;
+    guint32 desktop;
+    gint32  x, y, w, h;
+} ObSessionBinWindow;
+
+/*! Maps the key for a saved state, made from its session id, to a list of
+  its links in session_saved_state */
+static GHashTable *saved_by_id = NULL;
+/*! Maps the key for a saved state, made from its command, to a list of its
+  links in session_saved_state */
+static GHashTable *saved_by_command = NULL;
+
+/* for reporting how long it took to restore the session */
+static guint  restore_matched = 0;
+static gint64 restore_time = 0;
 
 void session_startup(gint argc, gchar **argv)
 {
@@ -152,6 +219,7 @@ void session_shutdown(gboolean permanent)
 
         SmcCloseConnection(sm_conn, 0, NULL);
 
+        session_index_clear();
         while (session_saved_state) {
             session_state_free(session_saved_state->data);
             session_saved_state = g_list_delete_link(session_saved_state,
@@ -464,7 +532,78 @@ static void sm_shutdown_cancelled(SmcConn conn, SmPointer data)
     ob_debug_type(OB_DEBUG_SM, "Shutdown cancelled");
 }
 
-static gboolean session_save_to_file(const ObSMSaveData *savedata)
+/*! Makes the state that will be saved for a client, or returns NULL if it
+  can't be saved */
+static ObSessionState* session_state_new(ObClient *c,
+                                         const ObSMSaveData *savedata)
+{
+    ObSessionState *s;
+    gint prex, prey, prew, preh;
+
+    if (!c->sm_client_id) {
+        ob_debug_type(OB_DEBUG_SM, "Client %s does not have a "
+                      "session id set",
+                      c->title);
+        if (!c->wm_command) {
+            ob_debug_type(OB_DEBUG_SM, "Client %s does not have an "
+                          "oldskool wm_command set either. We won't "
+                          "be saving its data",
+                          c->title);
+            return NULL;
+        }
+    }
+
+    ob_debug_type(OB_DEBUG_SM, "Saving state for client %s",
+                  c->title);
+
+    prex = c->area.x;
+    prey = c->area.y;
+    prew = c->area.width;
+    preh = c->area.height;
+    if (c->fullscreen) {
+        prex = c->pre_fullscreen_area.x;
+        prey = c->pre_fullscreen_area.x;
+        prew = c->pre_fullscreen_area.width;
+        preh = c->pre_fullscreen_area.height;
+    }
+    if (c->max_horz) {
+        prex = c->pre_max_area.x;
+        prew = c->pre_max_area.width;
+    }
+    if (c->max_vert) {
+        prey = c->pre_max_area.y;
+        preh = c->pre_max_area.height;
+    }
+
+    s = g_slice_new0(ObSessionState);
+    if (c->sm_client_id)
+        s->id = g_strdup(c->sm_client_id);
+    else
+        s->command = g_strdup(c->wm_command);
+    s->name = g_strdup(c->name);
+    s->class = g_strdup(c->class);
+    s->role = g_strdup(c->role);
+    s->type = c->type;
+    s->desktop = c->desktop;
+    s->x = prex;
+    s->y = prey;
+    s->w = prew;
+    s->h = preh;
+    s->shaded = c->shaded;
+    s->iconic = c->iconic;
+    s->skip_pager = c->skip_pager;
+    s->skip_taskbar = c->skip_taskbar;
+    s->fullscreen = c->fullscreen;
+    s->above = c->above;
+    s->below = c->below;
+    s->max_horz = c->max_horz;
+    s->max_vert = c->max_vert;
+    s->undecorated = c->undecorated;
+    s->focused = savedata->focus_client == c;
+    return s;
+}
+
+static gboolean session_save_xml(const ObSMSaveData *savedata, GList *states)
 {
     FILE *f;
     GList *it;
@@ -507,103 +646,58 @@ static gboolean session_save_to_file(const ObSMSaveData *savedata)
             fprintf(f, "</desktopnames>\n");
         }
 
-        /* they are ordered top to bottom in stacking order */
-        for (it = stacking_list; it; it = g_list_next(it)) {
-            gint prex, prey, prew, preh;
-            ObClient *c;
+        for (it = states; it; it = g_list_next(it)) {
+            ObSessionState *s = it->data;
             gchar *t;
 
-            if (WINDOW_IS_CLIENT(it->data))
-                c = WINDOW_AS_CLIENT(it->data);
-            else
-                continue;
-
-            if (!client_normal(c))
-                continue;
-
-            if (!c->sm_client_id) {
-                ob_debug_type(OB_DEBUG_SM, "Client %s does not have a "
-                              "session id set",
-                              c->title);
-                if (!c->wm_command) {
-                    ob_debug_type(OB_DEBUG_SM, "Client %s does not have an "
-                                  "oldskool wm_command set either. We won't "
-                                  "be saving its data",
-                                  c->title);
-                    continue;
-                }
-            }
-
-            ob_debug_type(OB_DEBUG_SM, "Saving state for client %s",
-                          c->title);
-
-            prex = c->area.x;
-            prey = c->area.y;
-            prew = c->area.width;
-            preh = c->area.height;
-            if (c->fullscreen) {
-                prex = c->pre_fullscreen_area.x;
-                prey = c->pre_fullscreen_area.x;
-                prew = c->pre_fullscreen_area.width;
-                preh = c->pre_fullscreen_area.height;
-            }
-            if (c->max_horz) {
-                prex = c->pre_max_area.x;
-                prew = c->pre_max_area.width;
-            }
-            if (c->max_vert) {
-                prey = c->pre_max_area.y;
-                preh = c->pre_max_area.height;
-            }
-
-            if (c->sm_client_id)
-                fprintf(f, "<window id=\"%s\">\n", c->sm_client_id);
+            if (s->id)
+                fprintf(f, "<window id=\"%s\">\n", s->id);
             else {
-                t = g_markup_escape_text(c->wm_command, -1);
+                t = g_markup_escape_text(s->command, -1);
                 fprintf(f, "<window command=\"%s\">\n", t);
                 g_free(t);
             }
 
-            t = g_markup_escape_text(c->name, -1);
+            t = g_markup_escape_text(s->name, -1);
             fprintf(f, "\t<name>%s</name>\n", t);
             g_free(t);
 
-            t = g_markup_escape_text(c->class, -1);
+            t = g_markup_escape_text(s->class, -1);
             fprintf(f, "\t<class>%s</class>\n", t);
             g_free(t);
 
-            t = g_markup_escape_text(c->role, -1);
+            t = g_markup_escape_text(s->role, -1);
             fprintf(f, "\t<role>%s</role>\n", t);
             g_free(t);
 
-            fprintf(f, "\t<windowtype>%d</windowtype>\n", c->type);
+            fprintf(f, "\t<windowtype>%d</windowtype>\n", s->type);
 
-            fprintf(f, "\t<desktop>%d</desktop>\n", c->desktop);
-            fprintf(f, "\t<x>%d</x>\n", prex);
-            fprintf(f, "\t<y>%d</y>\n", prey);
-            fprintf(f, "\t<width>%d</width>\n", prew);
-            fprintf(f, "\t<height>%d</height>\n", preh);
-            if (c->shaded)
+            fprintf(f, "\t<desktop>%d</desktop>\n", s->desktop);
+            fprintf(f, "\t<x>%d</x>\n", s->x);
+            fprintf(f, "\t<y>%d</y>\n", s->y);
+            fprintf(f, "\t<width>%d</width>\n", s->w);
+            fprintf(f, "\t<height>%d</height>\n", s->h);
+            if (s->shaded)
                 fprintf(f, "\t<shaded />\n");
-            if (c->iconic)
+            if (s->iconic)
                 fprintf(f, "\t<iconic />\n");
-            if (c->skip_pager)
+            if (s->skip_pager)
                 fprintf(f, "\t<skip_pager />\n");
-            if (c->skip_taskbar)
+            if (s->skip_taskbar)
                 fprintf(f, "\t<skip_taskbar />\n");
-            if (c->fullscreen)
+            if (s->fullscreen)
                 fprintf(f, "\t<fullscreen />\n");
-            if (c->above)
+            if (s->above)
                 fprintf(f, "\t<above />\n");
-            if (c->below)
+            if (s->below)
                 fprintf(f, "\t<below />\n");
-            if (c->max_horz)
+            if (s->max_horz)
                 fprintf(f, "\t<max_horz />\n");
-            if (c->max_vert)
+            if (s->max_vert)
                 fprintf(f, "\t<max_vert />\n");
-            if (c->undecorated)
+            if (s->undecorated)
                 fprintf(f, "\t<undecorated />\n");
-            if (savedata->focus_client == c)
+            if (s->focused)
                 fprintf(f, "\t<focused />\n");
             fprintf(f, "</window>\n\n");
         }
@@ -621,6 +715,145 @@ static gboolean session_save_to_file(const ObSMSaveData *savedata)
     return success;
 }
 
+/*! Returns the nanoseconds part of the file's modification time, so that the
+  XML file being saved again within the same second is noticed */
+static gint64 stat_mtime_nsec(const GStatBuf *st)
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    return st->st_mtim.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/*! Appends a string to the binary session, as its length followed by its
+  bytes, nul terminated and padded to keep the next field aligned */
+static void bin_append_string(GByteArray *buf, const gchar *s)
+{
+    static const guint8 zeros[4] = { 0, 0, 0, 0 };
+    guint32 len = strlen(s);
+
+    g_byte_array_append(buf, (guint8*)&len, sizeof(len));
+    g_byte_array_append(buf, (const guint8*)s, len);
+    g_byte_array_append(buf, zeros, 4 - len % 4);
+}
+
+/*! Writes the session next to the XML file, so it can be loaded without
+  parsing the XML.  The XML file is always written first, and the binary one
+  is only used if it was written for that XML file. */
+static void session_save_binary(const ObSMSaveData *savedata, GList *states)
+{
+    GByteArray *buf;
+    ObSessionBinHeader *h;
+    GList *it;
+    GStatBuf st;
+    gchar *path;
+    gint i;
+    GError *e = NULL;
+
+    path = g_strconcat(ob_sm_save_file, SESSION_BIN_SUFFIX, NULL);
+    if (g_stat(ob_sm_save_file, &st) < 0) {
+        g_unlink(path);
+        g_free(path);
+        return;
+    }
+
+    buf = g_byte_array_sized_new(16 * 1024);
+    g_byte_array_set_size(buf, sizeof(ObSessionBinHeader));
+    h = (ObSessionBinHeader*)buf->data;
+    memset(h, 0, sizeof(*h));
+    h->xml_size = st.st_size;
+    h->xml_mtime = st.st_mtime;
+    h->xml_mtime_nsec = stat_mtime_nsec(&st);
+    h->desktop = savedata->desktop;
+    h->num_desktops = screen_num_desktops;
+    h->orientation = screen_desktop_layout.orientation;
+    h->start_corner = screen_desktop_layout.start_corner;
+    h->columns = screen_desktop_layout.columns;
+    h->rows = screen_desktop_layout.rows;
+
+    for (i = 0; screen_desktop_names && screen_desktop_names[i]; ++i)
+        bin_append_string(buf, screen_desktop_names[i]);
+    ((ObSessionBinHeader*)buf->data)->n_names = i;
+
+    for (it = states; it; it = g_list_next(it)) {
+        ObSessionState *s = it->data;
+        ObSessionBinWindow w;
+
+        w.flags =
+            (s->id           ? SESSION_BIN_ID           : 0) |
+            (s->shaded       ? SESSION_BIN_SHADED       : 0) |
+            (s->iconic       ? SESSION_BIN_ICONIC       : 0) |
+            (s->skip_pager   ? SESSION_BIN_SKIP_PAGER   : 0) |
+            (s->skip_taskbar ? SESSION_BIN_SKIP_TASKBAR : 0) |
+            (s->fullscreen   ? SESSION_BIN_FULLSCREEN   : 0) |
+            (s->above        ? SESSION_BIN_ABOVE        : 0) |
+            (s->below        ? SESSION_BIN_BELOW        : 0) |
+            (s->max_horz     ? SESSION_BIN_MAX_HORZ     : 0) |
+            (s->max_vert     ? SESSION_BIN_MAX_VERT     : 0) |
+            (s->undecorated  ? SESSION_BIN_UNDECORATED  : 0) |
+            (s->focused      ? SESSION_BIN_FOCUSED      : 0);
+        w.type = s->type;
+        w.desktop = s->desktop;
+        w.x = s->x;
+        w.y = s->y;
+        w.w = s->w;
+        w.h = s->h;
+        g_byte_array_append(buf, (guint8*)&w, sizeof(w));
+        bin_append_string(buf, s->id ? s->id : s->command);
+        bin_append_string(buf, s->name);
+        bin_append_string(buf, s->class);
+        bin_append_string(buf, s->role);
+        ++((ObSessionBinHeader*)buf->data)->n_windows;
+    }
+
+    /* the array may have moved while it grew */
+    h = (ObSessionBinHeader*)buf->data;
+    h->magic = SESSION_BIN_MAGIC;
+    h->version = SESSION_BIN_VERSION;
+    h->size = buf->len - sizeof(ObSessionBinHeader);
+    h->checksum = ob_checksum(buf->data + sizeof(ObSessionBinHeader), h->size);
+
+    if (!g_file_set_contents(path, (gchar*)buf->data, buf->len, &e)) {
+        /* the XML file is still there to load from */
+        ob_debug_type(OB_DEBUG_SM, "Unable to save the binary session: %s",
+                      e->message);
+        g_error_free(e);
+        g_unlink(path);
+    }
+
+    g_byte_array_free(buf, TRUE);
+    g_free(path);
+}
+
+static gboolean session_save_to_file(const ObSMSaveData *savedata)
+{
+    GList *it, *states = NULL;
+    gboolean success;
+
+    /* they are ordered top to bottom in stacking order */
+    for (it = stacking_list; it; it = g_list_next(it)) {
+        ObSessionState *s;
+
+        if (!WINDOW_IS_CLIENT(it->data) ||
+            !client_normal(WINDOW_AS_CLIENT(it->data)))
+            continue;
+
+        if ((s = session_state_new(WINDOW_AS_CLIENT(it->data), savedata)))
+            states = g_list_prepend(states, s);
+    }
+    states = g_list_reverse(states);
+
+    if ((success = session_save_xml(savedata, states)))
+        session_save_binary(savedata, states);
+
+    while (states) {
+        session_state_free(states->data);
+        states = g_list_delete_link(states, states);
+    }
+    return success;
+}
+
 static void session_state_free(ObSessionState *state)
 {
     if (state) {
@@ -668,25 +901,305 @@ static gboolean session_state_cmp(ObSessionState *s, ObClient *c)
     return FALSE;
 }
 
+static void session_key_append(GString *key, const gchar *s)
+{
+    if (s)
+        g_string_append_printf(key, "%" G_GSIZE_FORMAT ":%s", strlen(s), s);
+    else
+        g_string_append_c(key, '-');
+}
+
+/*! Makes the key that a saved state is indexed by.  The states that would be
+  removed as duplicates of each other all have the same key, and no others
+  do, as each field is written with its length, and a missing field is
+  written differently from an empty one. */
+static gchar* session_state_key(const gchar *who, const gchar *name,
+                                const gchar *class, const gchar *role)
+{
+    GString *key = g_string_new(NULL);
+
+    session_key_append(key, who);
+    session_key_append(key, name);
+    session_key_append(key, class);
+    session_key_append(key, role);
+    return g_string_free(key, FALSE);
+}
+
+static GList* session_index_find(GHashTable *index, const gchar *who,
+                                 ObClient *c)
+{
+    gchar *key;
+    GList *it;
+
+    if (!index || !who) return NULL;
+
+    key = session_state_key(who, c->name, c->class, c->role);
+    it = g_hash_table_lookup(index, key);
+    g_free(key);
+
+    for (; it; it = g_list_next(it)) {
+        GList *link = it->data;
+        ObSessionState *s = link->data;
+
+        /* the key doesn't include the type, so compare them properly */
+        if (!s->matched && session_state_cmp(s, c))
+            return link;
+    }
+    return NULL;
+}
+
 GList* session_state_find(ObClient *c)
+{
+    GList *by_id, *by_command, *it;
+    gint64 start;
+
+    if (!session_saved_state) return NULL;
+
+    start = g_get_monotonic_time();
+
+    by_id = session_index_find(saved_by_id, c->sm_client_id, c);
+    by_command = session_index_find(saved_by_command, c->wm_command, c);
+
+    /* if the client matches two states then use the first one, the same as
+       looking through the list would */
+    if (by_id && by_command)
+        it = g_list_position(session_saved_state, by_id) <
+            g_list_position(session_saved_state, by_command) ?
+            by_id : by_command;
+    else
+        it = by_id ? by_id : by_command;
+
+    /* a state is only indexed by its id when it has one, but can still match
+       a client by its command, so look through them all before giving up */
+    if (!it) {
+        for (it = session_saved_state; it; it = g_list_next(it)) {
+            ObSessionState *s = it->data;
+            if (!s->matched && session_state_cmp(s, c))
+                break;
+        }
+    }
+
+    if (it) {
+        ((ObSessionState*)it->data)->matched = TRUE;
+        ++restore_matched;
+    }
+
+    restore_time += g_get_monotonic_time() - start;
+    return it;
+}
+
+void session_report_restore(void)
+{
+    if (!session_saved_state) return;
+
+    ob_debug_type(OB_DEBUG_SM,
+                  "Restored %u of %u saved windows, matching them took "
+                  "%.3f ms", restore_matched,
+                  g_list_length(session_saved_state), restore_time / 1000.0);
+}
+
+static void session_index_clear(void)
+{
+    if (saved_by_id) g_hash_table_destroy(saved_by_id);
+    if (saved_by_command) g_hash_table_destroy(saved_by_command);
+    saved_by_id = saved_by_command = NULL;
+}
+
+/*! Indexes the saved states, and removes any duplicates from them.  This
+  means that if two windows (or more) are saved with the same session state,
+  we won't restore a session for any of them because we don't know what
+  window to put what on. AHEM FIREFOX. */
+static void session_index_dedup(GHashTable *index)
+{
+    GHashTableIter iter;
+    gpointer links;
+
+    g_hash_table_iter_init(&iter, index);
+    while (g_hash_table_iter_next(&iter, NULL, &links)) {
+        GList *it;
+
+        if (!g_list_next((GList*)links)) continue;
+
+        for (it = links; it; it = g_list_next(it)) {
+            GList *link = it->data;
+            ObSessionState *s = link->data;
+
+            ob_debug_type(OB_DEBUG_SM, "removing duplicate %s", s->name);
+            session_state_free(s);
+            session_saved_state = g_list_delete_link(session_saved_state,
+                                                     link);
+        }
+        g_hash_table_iter_remove(&iter);
+    }
+}
+
+static void session_index_build(void)
 {
     GList *it;
 
+    session_index_clear();
+    saved_by_id = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                        g_free, (GDestroyNotify)g_list_free);
+    saved_by_command = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                             g_free,
+                                             (GDestroyNotify)g_list_free);
+
     for (it = session_saved_state; it; it = g_list_next(it)) {
         ObSessionState *s = it->data;
-        if (!s->matched && session_state_cmp(s, c)) {
-            s->matched = TRUE;
-            break;
-        }
+        GHashTable *index = s->id ? saved_by_id : saved_by_command;
+        gchar *key;
+        GList *links;
+
+        key = session_state_key(s->id ? s->id : s->command,
+                                s->name, s->class, s->role);
+        /* appending keeps each list in the same order as the states, and
+           doesn't move the head of the list that is in the table */
+        if ((links = g_hash_table_lookup(index, key))) {
+            g_list_append(links, it);
+            g_free(key);
+        } else
+            g_hash_table_insert(index, key, g_list_append(NULL, it));
     }
-    return it;
+
+    session_index_dedup(saved_by_id);
+    session_index_dedup(saved_by_command);
 }
 
-static void session_load_file(const gchar *path)
+/*! Reads a string written by bin_append_string, or returns NULL if it runs
+  past the end of the data */
+static gchar* bin_read_string(const gchar *data, gsize len, gsize *off)
+{
+    guint32 slen;
+    gchar *s;
+
+    if (len - *off < sizeof(slen)) return NULL;
+    memcpy(&slen, data + *off, sizeof(slen));
+    *off += sizeof(slen);
+
+    if (len - *off < (gsize)slen + 4 - slen % 4) return NULL;
+    s = g_strndup(data + *off, slen);
+    *off += (gsize)slen + 4 - slen % 4;
+    return s;
+}
+
+/*! Loads the binary session saved next to the XML file at path.  Returns
+  FALSE, without loading anything, if there isn't one or it wasn't saved
+  along with the XML file as it is now. */
+static gboolean session_load_binary(const gchar *path)
+{
+    GMappedFile *map;
+    const gchar *data;
+    gsize len, off;
+    ObSessionBinHeader h;
+    GStatBuf st;
+    gchar *binpath;
+    GList *states = NULL;
+    GSList *names = NULL;
+    guint i;
+    gboolean ok = FALSE;
+
+    if (g_stat(path, &st) < 0) return FALSE;
+
+    binpath = g_strconcat(path, SESSION_BIN_SUFFIX, NULL);
+    map = g_mapped_file_new(binpath, FALSE, NULL);
+    g_free(binpath);
+    if (!map) return FALSE;
+
+    data = g_mapped_file_get_contents(map);
+    len = g_mapped_file_get_length(map);
+
+    if (len < sizeof(h)) goto done;
+    memcpy(&h, data, sizeof(h));
+    if (h.magic != SESSION_BIN_MAGIC || h.version != SESSION_BIN_VERSION ||
+        h.size != len - sizeof(h) ||
+        h.checksum != ob_checksum((const guchar*)data + sizeof(h), h.size))
+        goto done;
+    /* the XML file may have been changed or saved again since */
+    if (h.xml_size != (guint64)st.st_size ||
+        h.xml_mtime != (gint64)st.st_mtime ||
+        h.xml_mtime_nsec != stat_mtime_nsec(&st))
+        goto done;
+
+    off = sizeof(h);
+    for (i = 0; i < h.n_names; ++i) {
+        gchar *name;
+
+        if (!(name = bin_read_string(data, len, &off))) goto done;
+        names = g_slist_prepend(names, name);
+    }
+
+    for (i = 0; i < h.n_windows; ++i) {
+        ObSessionBinWindow w;
+        ObSessionState *s;
+        gchar *who;
+
+        if (len - off < sizeof(w)) goto done;
+        memcpy(&w, data + off, sizeof(w));
+        off += sizeof(w);
+
+        s = g_slice_new0(ObSessionState);
+        states = g_list_prepend(states, s);
+
+        who = bin_read_string(data, len, &off);
+        if (w.flags & SESSION_BIN_ID)
+            s->id = who;
+        else
+            s->command = who;
+        if (!who ||
+            !(s->name = bin_read_string(data, len, &off)) ||
+            !(s->class = bin_read_string(data, len, &off)) ||
+            !(s->role = bin_read_string(data, len, &off)))
+            goto done;
+
+        s->type = w.type;
+        s->desktop = w.desktop;
+        s->x = w.x;
+        s->y = w.y;
+        s->w = w.w;
+        s->h = w.h;
+        s->shaded = !!(w.flags & SESSION_BIN_SHADED);
+        s->iconic = !!(w.flags & SESSION_BIN_ICONIC);
+        s->skip_pager = !!(w.flags & SESSION_BIN_SKIP_PAGER);
+        s->skip_taskbar = !!(w.flags & SESSION_BIN_SKIP_TASKBAR);
+        s->fullscreen = !!(w.flags & SESSION_BIN_FULLSCREEN);
+        s->above = !!(w.flags & SESSION_BIN_ABOVE);
+        s->below = !!(w.flags & SESSION_BIN_BELOW);
+        s->max_horz = !!(w.flags & SESSION_BIN_MAX_HORZ);
+        s->max_vert = !!(w.flags & SESSION_BIN_MAX_VERT);
+        s->undecorated = !!(w.flags & SESSION_BIN_UNDECORATED);
+        s->focused = !!(w.flags & SESSION_BIN_FOCUSED);
+        ob_debug_type(OB_DEBUG_SM, "loaded %s", s->name);
+    }
+    ok = off == len;
+
+done:
+    g_mapped_file_unref(map);
+
+    if (!ok) {
+        ob_debug_type(OB_DEBUG_SM, "Not using the binary session file");
+        g_slist_free_full(names, g_free);
+        g_list_free_full(states, (GDestroyNotify)session_state_free);
+        return FALSE;
+    }
+
+    session_desktop = h.desktop;
+    session_num_desktops = h.num_desktops;
+    session_desktop_layout.orientation = h.orientation;
+    session_desktop_layout.start_corner = h.start_corner;
+    session_desktop_layout.columns = h.columns;
+    session_desktop_layout.rows = h.rows;
+    session_desktop_layout_present = TRUE;
+    session_desktop_names = g_slist_concat(session_desktop_names,
+                                           g_slist_reverse(names));
+    /* like the XML loader, leave them in reverse order for the caller */
+    session_saved_state = g_list_concat(states, session_saved_state);
+    return TRUE;
+}
+
+static void session_load_xml(const gchar *path)
 {
     ObtXmlInst *i;
     xmlNodePtr node, n, m;
-    GList *it, *inext;
 
     i = obt_xml_instance_new();
 
@@ -788,8 +1301,8 @@ static void session_load_file(const gchar *path)
             obt_xml_find_node(node->children, "focused") != NULL;
 
         /* save this. they are in the file in stacking order, so preserve
-           that order here */
-        session_saved_state = g_list_append(session_saved_state, state);
+           that order here (the list is reversed when they are all loaded) */
+        session_saved_state = g_list_prepend(session_saved_state, state);
         ob_debug_type(OB_DEBUG_SM, "loaded %s", state->name);
         continue;
 
@@ -798,53 +1311,16 @@ static void session_load_file(const gchar *path)
         session_state_free(state);
     }
 
-    /* Remove any duplicates.  This means that if two windows (or more) are
-       saved with the same session state, we won't restore a session for any
-       of them because we don't know what window to put what on. AHEM FIREFOX.
-
-       This is going to be an O(2^n) kind of operation unfortunately.
-    */
-    for (it = session_saved_state; it; it = inext) {
-        GList *jt, *jnext;
-        gboolean founddup = FALSE;
-        ObSessionState *s1 = it->data;
-
-        inext = g_list_next(it);
-
-        for (jt = g_list_next(it); jt; jt = jnext) {
-            ObSessionState *s2 = jt->data;
-            gboolean match;
-
-            jnext = g_list_next(jt);
-
-            if (s1->id && s2->id)
-                match = strcmp(s1->id, s2->id) == 0;
-            else if (s1->command && s2->command)
-                match = strcmp(s1->command, s2->command) == 0;
-            else
-                match = FALSE;
-
-            if (match &&
-                !strcmp(s1->name, s2->name) &&
-                !strcmp(s1->class, s2->class) &&
-                !strcmp(s1->role, s2->role))
-            {
-                ob_debug_type(OB_DEBUG_SM, "removing duplicate %s", s2->name);
-                session_state_free(s2);
-                session_saved_state =
-                    g_list_delete_link(session_saved_state, jt);
-                founddup = TRUE;
-            }
-        }
+    obt_xml_instance_unref(i);
+}
 
-        if (founddup) {
-            ob_debug_type(OB_DEBUG_SM, "removing duplicate %s", s1->name);
-            session_state_free(s1);
-            session_saved_state = g_list_delete_link(session_saved_state, it);
-        }
-    }
+static void session_load_file(const gchar *path)
+{
+    if (!session_load_binary(path))
+        session_load_xml(path);
 
-    obt_xml_instance_unref(i);
+    session_saved_state = g_list_reverse(session_saved_state);
+    session_index_build();
 }
 
 void session_request_logout(gboolean silent)
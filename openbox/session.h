@@ -36,6 +36,8 @@ struct _ObSessionState {
     gboolean focused;
 
     gboolean matched;
+    /*! The client which is using this state, if it is still managed */
+    struct _ObClient *client;
 };
 
 /*! The desktop being viewed when the session was saved. A valud of -1 means
@@ -51,8 +53,14 @@ extern GList *session_saved_state;
 void session_startup(gint argc, gchar **argv);
 void session_shutdown(gboolean permanent);
 
+/*! Finds the saved state for a client being managed, and marks it as used.
+  Returns its link in session_saved_state, or NULL if there isn't one. */
 GList* session_state_find(struct _ObClient *c);
 
+/*! Reports how many windows got their saved state back, and how long it took
+  to find their states, once the existing windows have been managed */
+void session_report_restore(void);
+
 void session_request_logout(gboolean silent);
 
 gboolean session_connected(void);
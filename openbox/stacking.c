@@ -36,6 +36,13 @@ GList  *stacking_list_tail = NULL;
   to freeze the on-screen stacking order while a window is being temporarily
   raised during focus cycling */
 static gboolean pause_changes = FALSE;
+/*! While this is non-zero, stacking changes are only made to the
+  stacking_list, and are sent to the X server all at once afterwards */
+static guint freeze = 0;
+/*! The windows which have moved in the stacking_list while frozen.  These are
+  only compared against what is in the stacking_list, so it doesn't matter if
+  some of them go away. */
+static GHashTable *freeze_moved = NULL;
 
 void stacking_set_list(void)
 {
@@ -109,10 +116,60 @@ static void do_restack(GList *wins, GList *before)
     }
 #endif
 
-    if (!pause_changes)
-        XRestackWindows(obt_display, win, i);
+    if (freeze) {
+        for (it = wins; it; it = g_list_next(it))
+            g_hash_table_add(freeze_moved, it->data);
+    }
+    else {
+        if (!pause_changes)
+            XRestackWindows(obt_display, win, i);
+        stacking_set_list();
+    }
     g_free(win);
+}
 
+void stacking_freeze(void)
+{
+    if (!freeze++)
+        freeze_moved = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+void stacking_thaw(void)
+{
+    Window *win;
+    GList *it, *first, *last;
+    gint i, n;
+
+    g_return_if_fail(freeze > 0);
+
+    if (--freeze) return;
+
+    /* find the part of the stacking order which has things that moved */
+    first = last = NULL;
+    n = 0;
+    for (it = stacking_list; it; it = g_list_next(it))
+        if (g_hash_table_contains(freeze_moved, it->data)) {
+            if (!first) first = it;
+            last = it;
+        }
+    g_hash_table_destroy(freeze_moved);
+    freeze_moved = NULL;
+    if (!first) return;
+
+    if (!pause_changes) {
+        /* everything outside of that part is still in the same order, so
+           only that part needs to be put back under the window above it */
+        for (it = first; it != last; it = g_list_next(it)) ++n;
+        win = g_new(Window, n + 2);
+        if (first == stacking_list)
+            win[0] = screen_support_win;
+        else
+            win[0] = window_top(g_list_previous(first)->data);
+        for (i = 1, it = first; i < n + 2; ++i, it = g_list_next(it))
+            win[i] = window_top(it->data);
+        XRestackWindows(obt_display, win, i);
+        g_free(win);
+    }
     stacking_set_list();
 }
 
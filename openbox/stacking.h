@@ -60,6 +60,12 @@ void stacking_temp_raise(struct _ObWindow *window);
 /*! Restores any temporarily raised windows to their correct place */
 void stacking_restore(void);
 
+/*! Collect the stacking changes made until stacking_thaw() is called, and
+  then restack the part of the stacking order which they changed all at
+  once.  These can be nested. */
+void stacking_freeze(void);
+void stacking_thaw(void);
+
 /*! Lowers a window below all others in its stacking layer */
 void stacking_lower(struct _ObWindow *window);
 
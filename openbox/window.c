@@ -26,6 +26,7 @@
 #include "prompt.h"
 #include "debug.h"
 #include "grab.h"
+#include "restart.h"
 #include "obt/prop.h"
 #include "obt/xqueue.h"
 
@@ -134,6 +135,9 @@ void window_manage_all(void)
         }
     }
 
+    /* map them in the order they were stacked before a restart */
+    restart_sort_windows(children, nchild);
+
     for (i = 0; i < nchild; ++i) {
         if (children[i] == None) continue;
         if (window_find(children[i])) continue; /* skip our own windows */